@@ -0,0 +1,254 @@
+#pragma once
+#include "AdjacencyListGraph.hpp"
+#include "FibonacciHeap.hpp"
+#include "Profiler.hpp"
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+
+// Events reported to the visit listener of an A* search
+enum class VisitState {
+	OPENED,	// pushed to the open list for the first time
+	CLOSED,	// popped from the open list and expanded
+	ON_PATH	// part of the returned path
+};
+
+// Work done by an A* search, the default stats policy of AStarSearch
+// The counters cost an increment per operation, the phases a clock read per step
+struct AStarStats {
+	static constexpr bool Enabled = true;
+	size_t expansions{ 0 };
+	size_t pushes{ 0 };
+	size_t decreaseKeys{ 0 };
+	size_t peakOpenSize{ 0 };
+	std::chrono::nanoseconds initializeTime{ 0 };
+	std::chrono::nanoseconds searchTime{ 0 };
+	std::chrono::nanoseconds reconstructTime{ 0 };
+};
+
+// Stats policy that collects nothing, the search is compiled without the counters and the phase clock reads
+// Its fields stay 0
+struct NoAStarStats : AStarStats {
+	static constexpr bool Enabled = false;
+};
+
+// Resumable A* search
+// The search is an explicit state machine over the open list: step expands vertices until a node budget
+// or a time budget is spent and returns, the next step resumes where it stopped.
+// Running the steps to completion gives the same path as AStar::shortestPath, which is implemented with it.
+// The graph's vertex attributes hold the search state, so the graph must not change while the search runs.
+// Stats is AStarStats to collect the work done, or NoAStarStats to leave it out.
+template <class Vertex,
+	class IsBlocked = std::function<bool(size_t)>,
+	class OnVisit = std::function<void(size_t, VisitState)>,
+	class Stats = AStarStats>
+class AStarSearch
+{
+public:
+	using Heuristic = std::function<float(const std::pair<float, float>&, const std::pair<float, float>&)>;
+	using Path = std::vector<std::pair<size_t, float>>;
+	static constexpr size_t Unlimited = std::numeric_limits<size_t>::max();
+	// Number of expansions between two clock reads when a time budget is given
+	static constexpr size_t ClockInterval = 64;
+
+	AStarSearch(AdjacencyListGraph<Vertex>& graph, size_t from, size_t to,
+		Heuristic heuristic, IsBlocked isBlocked, OnVisit onVisit);
+	AStarSearch(const AStarSearch&) = delete;
+	AStarSearch& operator=(const AStarSearch&) = delete;
+	bool step(size_t maxExpansions = Unlimited,
+		std::chrono::nanoseconds timeBudget = std::chrono::nanoseconds::max());
+	bool isDone() const;
+	size_t getExpansions() const;
+	const Stats& getStats() const;
+	const Path& getPath() const;
+private:
+	using Clock = std::chrono::steady_clock;
+	AdjacencyListGraph<Vertex>& m_graph;
+	size_t m_from, m_to;
+	Heuristic m_heuristic;
+	IsBlocked m_isBlocked;
+	OnVisit m_onVisit;
+	FibonacciHeap<size_t> m_minQ;
+	// Make a visited vector to prevent redundant calulations
+	std::vector<bool> m_visited;
+	// Make a handle vector for the decreaseKey operation
+	std::vector<typename FibonacciHeap<size_t>::Handle> m_handles;
+	Stats m_stats;
+	bool m_done{ false };
+	Path m_path;
+	void initialize();
+	void expand(size_t cur);
+	void finish();
+	void push(size_t vertex, float key);
+};
+
+template <class Vertex, class IsBlocked, class OnVisit, class Stats>
+AStarSearch<Vertex, IsBlocked, OnVisit, Stats>::AStarSearch(AdjacencyListGraph<Vertex>& graph, size_t from, size_t to,
+	Heuristic heuristic, IsBlocked isBlocked, OnVisit onVisit)
+	: m_graph(graph), m_from(from), m_to(to), m_heuristic(std::move(heuristic)),
+	m_isBlocked(std::move(isBlocked)), m_onVisit(std::move(onVisit)),
+	m_visited(graph.getNumVertices(), false), m_handles(graph.getNumVertices())
+{
+	Clock::time_point start;
+	if constexpr (Stats::Enabled)
+		start = Clock::now();
+	// Initialize the graph's gScroes, fScores, and parents
+	initialize();
+	push(from, graph.getVertexAttribute(from).fScore);
+	if constexpr (Stats::Enabled)
+		m_stats.initializeTime = Clock::now() - start;
+}
+
+// Expand up to maxExpansions vertices or until timeBudget has passed
+// Returns true once the search has finished and the path is available
+template <class Vertex, class IsBlocked, class OnVisit, class Stats>
+bool AStarSearch<Vertex, IsBlocked, OnVisit, Stats>::step(size_t maxExpansions, std::chrono::nanoseconds timeBudget) {
+	bool timed = timeBudget != std::chrono::nanoseconds::max();
+	Clock::time_point start;
+	if (Stats::Enabled || timed)
+		start = Clock::now();
+	auto deadline = timed ? start + timeBudget : Clock::time_point::max();
+	size_t expanded = 0;
+	bool found = false;
+	while (!m_done && expanded < maxExpansions) {
+		if (m_minQ.empty()) {
+			found = true;
+			break;
+		}
+		auto cur = m_minQ.top(); m_minQ.pop();
+		if (cur == m_to) {
+			// Found the target. Stop searching
+			found = true;
+			break;
+		}
+		if (!m_visited[cur]) {
+			expand(cur);
+			++expanded;
+			if (timed && expanded % ClockInterval == 0 && Clock::now() >= deadline)
+				break;
+		}
+	}
+	if constexpr (Stats::Enabled)
+		m_stats.searchTime += Clock::now() - start;
+	if (found)
+		finish();
+	return m_done;
+}
+
+template <class Vertex, class IsBlocked, class OnVisit, class Stats>
+void AStarSearch<Vertex, IsBlocked, OnVisit, Stats>::expand(size_t cur) {
+	m_visited[cur] = true;
+	if constexpr (Stats::Enabled)
+		++m_stats.expansions;
+	auto& adjs = m_graph.getAdjacent(cur);
+	auto& edgeAtts = m_graph.getEdgeAttributes(cur);
+	auto& curAtt = m_graph.getVertexAttribute(cur);
+	auto& goalAtt = m_graph.getVertexAttribute(m_to);
+	m_onVisit(cur, VisitState::CLOSED);
+	size_t adjSize = adjs.size();
+	for (size_t i = 0; i < adjSize; ++i) {
+		size_t neighbor = adjs[i];
+		auto& neighborAtt = m_graph.getVertexAttribute(neighbor);
+		if (m_isBlocked(neighbor))
+			continue;
+		float tentativeGScore = curAtt.gScore + edgeAtts[i];
+		// If the path through the current vertex is better, update the neighbor
+		if (!m_visited[neighbor] && (neighborAtt.gScore > tentativeGScore)) {
+			neighborAtt.parent = cur;
+			neighborAtt.gScore = tentativeGScore;
+			neighborAtt.fScore = tentativeGScore + m_heuristic(neighborAtt.pos, goalAtt.pos);
+
+			// Min priority queue selects the next vertex based on the fScore which is the sum of the gScore and the hScore.
+
+			// Push the neighbor to the minQ with neighbor's fScore as a key if the neighbor node hasn't been pushed before
+			if (m_handles[neighbor].isNull()) {
+				push(neighbor, neighborAtt.fScore);
+				m_onVisit(neighbor, VisitState::OPENED);
+			}
+			// Decrease the key otherwise
+			else {
+				m_minQ.decreaseKey(m_handles[neighbor], neighborAtt.fScore);
+				if constexpr (Stats::Enabled)
+					++m_stats.decreaseKeys;
+			}
+		}
+	}
+}
+
+// Construct the path using the vertex attributes calculated by the search
+template <class Vertex, class IsBlocked, class OnVisit, class Stats>
+void AStarSearch<Vertex, IsBlocked, OnVisit, Stats>::finish() {
+	Clock::time_point start;
+	if constexpr (Stats::Enabled)
+		start = Clock::now();
+	m_done = true;
+	size_t numVertices = m_graph.getNumVertices();
+	size_t cur = m_to;
+	while (cur < numVertices) {
+		auto& att = m_graph.getVertexAttribute(cur);
+		m_path.push_back({ cur, att.gScore });
+		cur = att.parent;
+	}
+	// Report the path
+	for (auto& step : m_path) {
+		m_onVisit(step.first, VisitState::ON_PATH);
+	}
+	// Reverse the order
+	m_path = Path(m_path.rbegin(), m_path.rend());
+	// Release the open list
+	m_minQ.clear();
+	if constexpr (Stats::Enabled) {
+		m_stats.reconstructTime = Clock::now() - start;
+		PROFILE_COUNTER("AStar expansions", m_stats.expansions);
+		PROFILE_COUNTER("AStar pushes", m_stats.pushes);
+		PROFILE_COUNTER("AStar decreaseKeys", m_stats.decreaseKeys);
+		PROFILE_COUNTER("AStar peak open size", m_stats.peakOpenSize);
+	}
+}
+
+template <class Vertex, class IsBlocked, class OnVisit, class Stats>
+void AStarSearch<Vertex, IsBlocked, OnVisit, Stats>::push(size_t vertex, float key) {
+	m_handles[vertex] = m_minQ.push(key, vertex);
+	if constexpr (Stats::Enabled) {
+		++m_stats.pushes;
+		m_stats.peakOpenSize = std::max(m_stats.peakOpenSize, m_minQ.size());
+	}
+}
+
+template <class Vertex, class IsBlocked, class OnVisit, class Stats>
+void AStarSearch<Vertex, IsBlocked, OnVisit, Stats>::initialize() {
+	// Set initial values
+	auto& vertexAtts = m_graph.getVertexAttributes();
+	for (auto& att : vertexAtts) {
+		att.gScore = std::numeric_limits<float>::infinity();
+		att.fScore = std::numeric_limits<float>::infinity();
+		att.parent = std::numeric_limits<size_t>::max();
+	}
+	// Set the gScore and the fScore of the source vertex to 0
+	vertexAtts[m_from].gScore = 0;
+	vertexAtts[m_from].fScore = 0;
+}
+
+template <class Vertex, class IsBlocked, class OnVisit, class Stats>
+bool AStarSearch<Vertex, IsBlocked, OnVisit, Stats>::isDone() const {
+	return m_done;
+}
+
+// Number of vertices expanded so far, 0 with NoAStarStats
+template <class Vertex, class IsBlocked, class OnVisit, class Stats>
+size_t AStarSearch<Vertex, IsBlocked, OnVisit, Stats>::getExpansions() const {
+	return m_stats.expansions;
+}
+
+// Counters and phase timings of the search so far
+template <class Vertex, class IsBlocked, class OnVisit, class Stats>
+const Stats& AStarSearch<Vertex, IsBlocked, OnVisit, Stats>::getStats() const {
+	return m_stats;
+}
+
+// From the source to the target with the gScore of each vertex, empty until the search is done
+template <class Vertex, class IsBlocked, class OnVisit, class Stats>
+const typename AStarSearch<Vertex, IsBlocked, OnVisit, Stats>::Path& AStarSearch<Vertex, IsBlocked, OnVisit, Stats>::getPath() const {
+	return m_path;
+}
@@ -5,7 +5,7 @@ template <class N, class D = float>
 class AdjacencyListGraph : public Graph<N, D>
 {
 public:
-    AdjacencyListGraph<N, D>(size_t numVertices) : Graph<N, D>(numVertices) {}
+    AdjacencyListGraph(size_t numVertices) : Graph<N, D>(numVertices) {}
     void addEdge(size_t fromIndex, size_t toIndex);
     void addEdge(size_t fromIndex, size_t toIndex, const D& attribute);
     std::vector<size_t>& getAdjacent(size_t index);
@@ -0,0 +1,23 @@
+#include "Profiler.hpp"
+#if PROFILE && PROFILE_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+// Replace the global operator new to count the allocations of each thread
+// Array and nothrow forms forward to these, aligned forms are not counted
+void* operator new(std::size_t size) {
+	++prof::detail::allocations;
+	prof::detail::allocatedBytes += size;
+	if (void* memory = std::malloc(size == 0 ? 1 : size))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+	std::free(memory);
+}
+#endif
@@ -7,9 +7,9 @@
 enum class ComponentType {
 	SHAPE,
 	TEXT,
-	CLICKABLE,
-	BLOCK
+	CLICKABLE
 };
+constexpr size_t ComponentTypeCount = 3;
 
 struct CShape
 {
@@ -45,8 +45,8 @@ struct CClickable
 		: onClickListener(listener1), additionalListener(listener2){}
 };
 
-struct CBlock {
-	bool isObstacle{ false };
-	bool isStart{ false };
-	bool isEnd{ false };
-};
\ No newline at end of file
+// ComponentType of each component struct
+template <class T> constexpr ComponentType componentTypeOf();
+template <> constexpr ComponentType componentTypeOf<CShape>() { return ComponentType::SHAPE; }
+template <> constexpr ComponentType componentTypeOf<CText>() { return ComponentType::TEXT; }
+template <> constexpr ComponentType componentTypeOf<CClickable>() { return ComponentType::CLICKABLE; }
@@ -0,0 +1,135 @@
+#pragma once
+#include "Component.hpp"
+#include <vector>
+#include <tuple>
+#include <limits>
+#include <cstdint>
+
+// Sparse set that stores the components of one type contiguously
+// m_sparse maps an entity id to the index of its component in m_dense,
+// m_entityIds maps the index back to the entity id.
+// Removal swaps the last component into the hole, so pointers and references
+// to components are only valid until the next structural change of the pool.
+template <class T>
+class ComponentPool
+{
+	static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> m_sparse;
+	std::vector<T> m_dense;
+	std::vector<size_t> m_entityIds;
+public:
+	template <class... TArgs> T& emplace(size_t id, TArgs&&... mArgs);
+	void remove(size_t id);
+	bool contains(size_t id) const;
+	T* get(size_t id);
+	size_t size() const;
+	void reserve(size_t size);
+	void clear();
+	std::vector<T>& getComponents();
+	const std::vector<size_t>& getEntityIds() const;
+};
+
+// Add a component to the entity, replacing the existing one
+template <class T>
+template <class... TArgs>
+T& ComponentPool<T>::emplace(size_t id, TArgs&&... mArgs) {
+	if (id >= m_sparse.size())
+		m_sparse.resize(id + 1, npos);
+	if (m_sparse[id] != npos) {
+		T& component = m_dense[m_sparse[id]];
+		component = T(std::forward<TArgs>(mArgs)...);
+		return component;
+	}
+	m_sparse[id] = static_cast<uint32_t>(m_dense.size());
+	m_entityIds.push_back(id);
+	return m_dense.emplace_back(std::forward<TArgs>(mArgs)...);
+}
+
+// Remove the component of the entity by moving the last component into its slot
+template <class T>
+void ComponentPool<T>::remove(size_t id) {
+	if (!contains(id))
+		return;
+	uint32_t index = m_sparse[id];
+	uint32_t last = static_cast<uint32_t>(m_dense.size() - 1);
+	if (index != last) {
+		m_dense[index] = std::move(m_dense[last]);
+		m_entityIds[index] = m_entityIds[last];
+		m_sparse[m_entityIds[index]] = index;
+	}
+	m_dense.pop_back();
+	m_entityIds.pop_back();
+	m_sparse[id] = npos;
+}
+
+template <class T>
+bool ComponentPool<T>::contains(size_t id) const {
+	return id < m_sparse.size() && m_sparse[id] != npos;
+}
+
+// Returns nullptr if the entity does not have the component
+template <class T>
+T* ComponentPool<T>::get(size_t id) {
+	if (!contains(id))
+		return nullptr;
+	return &m_dense[m_sparse[id]];
+}
+
+template <class T>
+size_t ComponentPool<T>::size() const {
+	return m_dense.size();
+}
+
+template <class T>
+void ComponentPool<T>::reserve(size_t size) {
+	m_dense.reserve(size);
+	m_entityIds.reserve(size);
+}
+
+template <class T>
+void ComponentPool<T>::clear() {
+	m_sparse.clear();
+	m_dense.clear();
+	m_entityIds.clear();
+}
+
+// Components in dense order
+template <class T>
+std::vector<T>& ComponentPool<T>::getComponents() {
+	return m_dense;
+}
+
+// Entity ids in the same order as getComponents()
+template <class T>
+const std::vector<size_t>& ComponentPool<T>::getEntityIds() const {
+	return m_entityIds;
+}
+
+
+// One pool per component type
+class ComponentRegistry
+{
+	std::tuple<
+		ComponentPool<CShape>
+		, ComponentPool<CClickable>
+		, ComponentPool<CText>
+	> m_pools;
+public:
+	template <class T> ComponentPool<T>& getPool();
+	void removeAll(size_t id);
+	void clear();
+};
+
+template <class T>
+ComponentPool<T>& ComponentRegistry::getPool() {
+	return std::get<ComponentPool<T>>(m_pools);
+}
+
+// Remove every component of the entity
+inline void ComponentRegistry::removeAll(size_t id) {
+	std::apply([id](auto&... pools) { (pools.remove(id), ...); }, m_pools);
+}
+
+inline void ComponentRegistry::clear() {
+	std::apply([](auto&... pools) { (pools.clear(), ...); }, m_pools);
+}
@@ -19,7 +19,16 @@ public:
 
 	static GameConfig& instance();
 	unsigned frameRate = 144;
-	std::chrono::milliseconds miliPerFrame = 2ms;
+	// The frame pacer spins instead of sleeping for the last part of a frame
+	std::chrono::microseconds pacerSpinTime = 1500us;
+	// Show the frame time percentiles in the window title
+	bool showFrameStats = false;
+	// Record the profile from the start, F9 toggles it at runtime
+	bool profileOnStart = false;
+	// Time the UI may spend applying path search results in one frame
+	std::chrono::milliseconds searchMiliPerFrame = 2ms;
+	// MovingAI map or PGM image loaded at startup instead of an empty grid
+	std::string mapFile = "";
 	int windowWidth = 1280;
 	int widowHeight = 720;
 	std::string windowName = "A* algorithm";
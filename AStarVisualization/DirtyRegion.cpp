@@ -0,0 +1,59 @@
+#include "DirtyRegion.hpp"
+#include <algorithm>
+
+sf::FloatRect DirtyRegion::getUnion(const sf::FloatRect& a, const sf::FloatRect& b) {
+	float left = std::min(a.left, b.left), top = std::min(a.top, b.top);
+	float right = std::max(a.left + a.width, b.left + b.width);
+	float bottom = std::max(a.top + a.height, b.top + b.height);
+	return { left, top, right - left, bottom - top };
+}
+
+// Merge the rect into the first rect it overlaps, or keep it as a new rect
+void DirtyRegion::add(const sf::FloatRect& rect) {
+	if (m_all || rect.width <= 0 || rect.height <= 0)
+		return;
+	for (auto& dirty : m_rects) {
+		if (dirty.intersects(rect)) {
+			dirty = getUnion(dirty, rect);
+			return;
+		}
+	}
+	m_rects.push_back(rect);
+	if (m_rects.size() > MaxRects) {
+		sf::FloatRect bounds = m_rects[0];
+		for (auto& dirty : m_rects)
+			bounds = getUnion(bounds, dirty);
+		m_rects.assign(1, bounds);
+	}
+}
+
+// Redraw everything, e.g. after the scene was rebuilt
+void DirtyRegion::addAll() {
+	m_all = true;
+	m_rects.clear();
+}
+
+void DirtyRegion::clear() {
+	m_all = false;
+	m_rects.clear();
+}
+
+bool DirtyRegion::empty() const {
+	return !m_all && m_rects.empty();
+}
+
+bool DirtyRegion::isAll() const {
+	return m_all;
+}
+
+const std::vector<sf::FloatRect>& DirtyRegion::getRects() const {
+	return m_rects;
+}
+
+// View that maps the pixels of a target onto themselves, its viewport clips everything outside of them
+sf::View DirtyRegion::getClipView(sf::Vector2u targetSize, const sf::FloatRect& pixels) {
+	sf::View view(pixels);
+	view.setViewport(sf::FloatRect(pixels.left / targetSize.x, pixels.top / targetSize.y,
+		pixels.width / targetSize.x, pixels.height / targetSize.y));
+	return view;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+// Screen areas that changed since the last render
+// Overlapping rects are merged when they are added, and too many rects collapse into their bounding box,
+// so the renderer redraws a few regions no matter how many changes were made.
+class DirtyRegion
+{
+	std::vector<sf::FloatRect> m_rects;
+	bool m_all{ false };
+	static sf::FloatRect getUnion(const sf::FloatRect& a, const sf::FloatRect& b);
+public:
+	static constexpr size_t MaxRects = 32;
+	void add(const sf::FloatRect& rect);
+	void addAll();
+	void clear();
+	bool empty() const;
+	bool isAll() const;
+	const std::vector<sf::FloatRect>& getRects() const;
+	static sf::View getClipView(sf::Vector2u targetSize, const sf::FloatRect& pixels);
+};
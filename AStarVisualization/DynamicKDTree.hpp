@@ -0,0 +1,194 @@
+#pragma once
+#include "KDTree.hpp"
+
+// Dynamic k-d tree using the logarithmic method
+// The pairs are kept in a forest of static KDTrees where level i holds at most 2^i pairs.
+// An insertion merges the full levels below the first level that can hold them,
+// so every pair is rebuilt O(log N) times and insertions cost amortized O(log^2 N), not O(log N):
+// a rebuild of n pairs selects medians on O(log n) levels and costs O(n log n).
+// Erased pairs are tombstoned by the static trees, which compact themselves
+// once half of their pairs are erased, so every query visits O(log N) balanced trees.
+// An erasure searches the trees one by one and costs O(log^2 N).
+template <size_t K, class Data, class T = float>
+class DynamicKDTree
+{
+public:
+	using Tree = KDTree<K, Data, T>;
+	using Point = typename Tree::Point;
+	using PointDataPair = typename Tree::PointDataPair;
+
+private:
+	std::vector<Tree> m_levels;
+	size_t m_size{ 0 };
+public:
+	DynamicKDTree() = default;
+	DynamicKDTree(const std::vector<PointDataPair>& pairs) { buildTree(pairs); }
+	void insert(const PointDataPair& pair);
+	bool erase(const Point& point, const Data& data);
+	PointDataPair findNearestNeighbor(const Point& target) const;
+	std::vector<PointDataPair> kNearest(const Point& target, size_t k) const;
+	std::vector<PointDataPair> searchRange(const Point& lowerBound, const Point& upperBound) const;
+	std::vector<PointDataPair> searchRadius(const Point& center, T radius) const;
+	template <class Visitor> void visitRange(const Point& lowerBound, const Point& upperBound, Visitor&& visitor) const;
+	template <class Visitor> void visitRadius(const Point& center, T radius, Visitor&& visitor) const;
+	void buildTree(const std::vector<PointDataPair>& pairs);
+	void clear();
+	size_t size() const;
+	bool empty() const;
+private:
+	static size_t getCapacity(size_t level);
+};
+
+// Insert a point data pair into the forest
+template <size_t K, class Data, class T>
+void DynamicKDTree<K, Data, T>::insert(const PointDataPair& pair) {
+	std::vector<PointDataPair> carry{ pair };
+	// Merge occupied levels until a free level is large enough for the carried pairs
+	for (size_t level = 0; ; ++level) {
+		if (level == m_levels.size())
+			m_levels.emplace_back();
+		auto& tree = m_levels[level];
+		if (tree.empty() && carry.size() <= getCapacity(level)) {
+			tree.buildTree(carry);
+			break;
+		}
+		auto pairs = tree.getPairs();
+		carry.insert(carry.end(), pairs.begin(), pairs.end());
+		tree.clear();
+	}
+	++m_size;
+}
+
+// Erase a point data pair from the forest
+// Returns false if the pair is not in the forest
+template <size_t K, class Data, class T>
+bool DynamicKDTree<K, Data, T>::erase(const Point& point, const Data& data) {
+	for (auto& tree : m_levels) {
+		if (tree.erase(point, data)) {
+			--m_size;
+			// Rebuild everything once the forest is mostly empty to drop the large levels
+			if (m_size * 4 < getCapacity(m_levels.size() - 1)) {
+				std::vector<PointDataPair> pairs;
+				pairs.reserve(m_size);
+				for (auto& level : m_levels) {
+					auto levelPairs = level.getPairs();
+					pairs.insert(pairs.end(), levelPairs.begin(), levelPairs.end());
+				}
+				buildTree(pairs);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+// Find a nearest point data pair to the given point in the forest
+template <size_t K, class Data, class T>
+typename DynamicKDTree<K, Data, T>::PointDataPair DynamicKDTree<K, Data, T>::findNearestNeighbor(const Point& target) const {
+	if (empty())
+		throw std::runtime_error("Tree is empty");
+	PointDataPair best;
+	T bestDist = std::numeric_limits<T>::max();
+	for (auto& tree : m_levels)
+		tree.findNearestNeighbor(target, best, bestDist);
+	return best;
+}
+
+// Find the k nearest point data pairs to the given point, closest first
+template <size_t K, class Data, class T>
+std::vector<typename DynamicKDTree<K, Data, T>::PointDataPair> DynamicKDTree<K, Data, T>::kNearest(const Point& target, size_t k) const {
+	std::vector<std::pair<T, PointDataPair>> candidates;
+	for (auto& tree : m_levels) {
+		for (auto& pair : tree.kNearest(target, k)) {
+			T distance = 0;
+			for (size_t i = 0; i < K; ++i) {
+				T diff = pair.first[i] - target[i];
+				distance += diff * diff;
+			}
+			candidates.push_back({ distance, std::move(pair) });
+		}
+	}
+	size_t count = std::min(k, candidates.size());
+	std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+		[](const auto& a, const auto& b) { return a.first < b.first; });
+	std::vector<PointDataPair> results;
+	results.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+		results.push_back(std::move(candidates[i].second));
+	return results;
+}
+
+// Find point data pairs in the given range
+template <size_t K, class Data, class T>
+std::vector<typename DynamicKDTree<K, Data, T>::PointDataPair> DynamicKDTree<K, Data, T>::searchRange(
+	const Point& lowerBound, const Point& upperBound) const {
+
+	std::vector<PointDataPair> results;
+	visitRange(lowerBound, upperBound, [&results](const Point& point, const Data& data) {
+		results.push_back({ point, data });
+		});
+	return results;
+}
+
+// Find point data pairs within the given distance of the center
+template <size_t K, class Data, class T>
+std::vector<typename DynamicKDTree<K, Data, T>::PointDataPair> DynamicKDTree<K, Data, T>::searchRadius(
+	const Point& center, T radius) const {
+
+	std::vector<PointDataPair> results;
+	visitRadius(center, radius, [&results](const Point& point, const Data& data) {
+		results.push_back({ point, data });
+		});
+	return results;
+}
+
+// Call visitor(point, data) for every pair in the given range
+template <size_t K, class Data, class T>
+template <class Visitor>
+void DynamicKDTree<K, Data, T>::visitRange(const Point& lowerBound, const Point& upperBound, Visitor&& visitor) const {
+	for (auto& tree : m_levels)
+		tree.visitRange(lowerBound, upperBound, visitor);
+}
+
+// Call visitor(point, data) for every pair within the given distance of the center
+template <size_t K, class Data, class T>
+template <class Visitor>
+void DynamicKDTree<K, Data, T>::visitRadius(const Point& center, T radius, Visitor&& visitor) const {
+	for (auto& tree : m_levels)
+		tree.visitRadius(center, radius, visitor);
+}
+
+// Clear the forest and put every given pair into a single level
+template <size_t K, class Data, class T>
+void DynamicKDTree<K, Data, T>::buildTree(const std::vector<PointDataPair>& pairs) {
+	clear();
+	if (pairs.empty())
+		return;
+	size_t level = 0;
+	while (getCapacity(level) < pairs.size())
+		++level;
+	m_levels.resize(level + 1);
+	m_levels[level].buildTree(pairs);
+	m_size = pairs.size();
+}
+
+template <size_t K, class Data, class T>
+void DynamicKDTree<K, Data, T>::clear() {
+	m_levels.clear();
+	m_size = 0;
+}
+
+template <size_t K, class Data, class T>
+size_t DynamicKDTree<K, Data, T>::size() const {
+	return m_size;
+}
+
+template <size_t K, class Data, class T>
+bool DynamicKDTree<K, Data, T>::empty() const {
+	return m_size == 0;
+}
+
+template <size_t K, class Data, class T>
+size_t DynamicKDTree<K, Data, T>::getCapacity(size_t level) {
+	return size_t(1) << level;
+}
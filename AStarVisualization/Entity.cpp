@@ -1,30 +1,33 @@
 #include "Entity.hpp"
-Entity::Entity(size_t id)
-	: m_id(id)
-{}
+#include "EntityManager.hpp"
+Entity::Entity(uint32_t index, EntityManager* manager, ComponentRegistry* registry)
+	: m_index(index), m_manager(manager), m_registry(registry)
+{
+	m_listIndices.fill(npos);
+}
+// The manager removes the entity in its next update
 void Entity::destroy() {
-	m_toDestroy = true;
+	if (!m_toDestroy) {
+		m_toDestroy = true;
+		m_manager->m_toDestroy.push_back(this);
+	}
 }
 bool Entity::isDestroyed() {
 	return m_toDestroy;
 }
+// The slot index, unique among the entities alive at the same time
 size_t Entity::getId() {
-	return m_id;
+	return m_index;
+}
+EntityHandle Entity::getHandle() {
+	return EntityHandle(m_index, m_generation);
 }
 
-std::vector<ComponentType> Entity::getComponentTypes() {
-	std::vector<ComponentType> types;
-	if (hasComponent<CShape>()) {
-		types.push_back(ComponentType::SHAPE);
-	}
-	if (hasComponent<CText>()) {
-		types.push_back(ComponentType::TEXT);
-	}
-	if (hasComponent<CClickable>()) {
-		types.push_back(ComponentType::CLICKABLE);
-	}
-	if (hasComponent<CBlock>()) {
-		types.push_back(ComponentType::BLOCK);
-	}
-	return types;
+// Bit i is set if the entity has the component of ComponentType i
+std::bitset<ComponentTypeCount> Entity::getComponentMask() {
+	std::bitset<ComponentTypeCount> mask;
+	mask[static_cast<size_t>(ComponentType::SHAPE)] = hasComponent<CShape>();
+	mask[static_cast<size_t>(ComponentType::TEXT)] = hasComponent<CText>();
+	mask[static_cast<size_t>(ComponentType::CLICKABLE)] = hasComponent<CClickable>();
+	return mask;
 }
@@ -1,52 +1,55 @@
 #pragma once
-#include "Component.hpp"
+#include "ComponentStorage.hpp"
+#include "EntityHandle.hpp"
 #include <vector>
 #include <memory>
-#include <unordered_map>
-#include <tuple>
-
-typedef std::tuple<
-	std::shared_ptr<CShape>
-	, std::shared_ptr<CClickable>
-	, std::shared_ptr<CText>
-	, std::shared_ptr<CBlock>
-> ComponentTuple;
+#include <array>
+#include <bitset>
 
+class EntityManager;
 
+// Entities live in the slots of the EntityManager that created them and are referred to by EntityHandles.
+// Components are stored in the ComponentRegistry of the EntityManager, keyed by the slot index.
+// Component pointers are invalidated when components of the same type are added or removed,
+// so they should not be kept across frames.
 class Entity {
 	friend class EntityManager;
-	size_t m_id{ 0 };
+	static constexpr size_t npos = std::numeric_limits<size_t>::max();
+	uint32_t m_index{ 0 };
+	uint32_t m_generation{ 0 };
 	bool m_toDestroy = false;
-	ComponentTuple m_components;
-	Entity(size_t id);
+	EntityManager* m_manager;
+	ComponentRegistry* m_registry;
+	// Positions in the lists of the EntityManager for the swap-and-pop removal
+	// Slot i is the position in the list of ComponentType i, the last slot is the position in the list of all entities
+	std::array<size_t, ComponentTypeCount + 1> m_listIndices;
+	Entity(uint32_t index, EntityManager* manager, ComponentRegistry* registry);
 public:
 	void destroy();
 	bool isDestroyed();
 	size_t getId();
-	template <class T, class... TArgs>  std::shared_ptr<T> addComponent(TArgs&&... mArgs);
-	template <class T> std::shared_ptr<T> getComponent();
+	EntityHandle getHandle();
+	template <class T, class... TArgs> T* addComponent(TArgs&&... mArgs);
+	template <class T> T* getComponent();
 	template <class T> void removeComponent();
 	template <class T> bool hasComponent();
-	std::vector<ComponentType> getComponentTypes();
+	std::bitset<ComponentTypeCount> getComponentMask();
 };
 
 template <class T, class... TArgs>
-std::shared_ptr<T> Entity::addComponent(TArgs&&... mArgs) {
-	auto newComp = std::shared_ptr<T>(new T(std::forward<TArgs>(mArgs)...));
-	std::get<std::shared_ptr<T>>(m_components) = newComp;
-	return newComp;
+T* Entity::addComponent(TArgs&&... mArgs) {
+	return &m_registry->getPool<T>().emplace(m_index, std::forward<TArgs>(mArgs)...);
 }
 
 template <class T> void Entity::removeComponent() {
-	std::get<std::shared_ptr<T>>(m_components).reset();
+	m_registry->getPool<T>().remove(m_index);
 }
 
-template <class T> std::shared_ptr<T> Entity::getComponent() {
-	return std::get<std::shared_ptr<T>>(m_components);
+// Returns nullptr if the entity does not have the component
+template <class T> T* Entity::getComponent() {
+	return m_registry->getPool<T>().get(m_index);
 }
 
 template <class T> bool Entity::hasComponent() {
-	if (std::get<std::shared_ptr<T>>(m_components))
-		return true;
-	return false;
-}
\ No newline at end of file
+	return m_registry->getPool<T>().contains(m_index);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+// 32-bit generational reference to an entity of an EntityManager
+// The low 24 bits are the slot index and the high 8 bits are the generation of the slot.
+// A slot's generation is incremented when its entity is removed,
+// so handles to removed entities are detected in O(1) and never alias a newer entity of the same slot
+// (until the generation wraps around after 256 reuses of the slot).
+struct EntityHandle
+{
+	static constexpr uint32_t IndexBits = 24;
+	static constexpr uint32_t IndexMask = (uint32_t(1) << IndexBits) - 1;
+	static constexpr uint32_t GenerationMask = (uint32_t(1) << (32 - IndexBits)) - 1;
+	static constexpr uint32_t Null = ~uint32_t(0);
+	uint32_t value{ Null };
+
+	EntityHandle() = default;
+	EntityHandle(uint32_t index, uint32_t generation)
+		: value((index & IndexMask) | ((generation & GenerationMask) << IndexBits)) {}
+	uint32_t getIndex() const { return value & IndexMask; }
+	uint32_t getGeneration() const { return value >> IndexBits; }
+	bool isNull() const { return value == Null; }
+	bool operator==(const EntityHandle& other) const = default;
+};
+
+template <>
+struct std::hash<EntityHandle> {
+	size_t operator()(const EntityHandle& handle) const { return std::hash<uint32_t>()(handle.value); }
+};
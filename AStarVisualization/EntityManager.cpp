@@ -1,50 +1,115 @@
 #include "EntityManager.hpp"
+#include <stdexcept>
 
 EntityManager::EntityManager() {};
+// Apply the additions and destructions since the last update
+// The cost is proportional to the number of changes, frames without changes cost nothing
 void EntityManager::update() {
+	if (m_toAdd.empty() && m_toDestroy.empty())
+		return;
 	// Add
 	for (auto entity : m_toAdd) {
-		m_entities.push_back(entity);
-		for (auto type : entity->getComponentTypes()) {
-			m_entityMap[type].push_back(entity);
+		addToList(m_entities, entity, allEntitiesSlot);
+		auto mask = entity->getComponentMask();
+		for (size_t type = 0; type < ComponentTypeCount; ++type) {
+			if (mask[type])
+				addToList(m_entityMap[type], entity, type);
 		}
 	}
 	m_toAdd.clear();
 	//Remove
-	for (auto& [type, entityList] : m_entityMap) {
-		removeDestroyedEntities(entityList);
+	for (auto entity : m_toDestroy) {
+		m_registry.removeAll(entity->getId());
+		for (size_t type = 0; type < ComponentTypeCount; ++type) {
+			if (entity->m_listIndices[type] != Entity::npos)
+				removeFromList(m_entityMap[type], entity, type);
+		}
+		removeFromList(m_entities, entity, allEntitiesSlot);
+		releaseSlot(entity);
 	}
-	removeDestroyedEntities(m_entities);
+	m_toDestroy.clear();
 }
 
+// Remove every entity, handles to them become invalid
 void EntityManager::clear() {
+	for (auto handle : m_entities)
+		releaseSlot(&m_slots[handle.getIndex()]);
+	for (auto entity : m_toAdd)
+		releaseSlot(entity);
 	m_entities.clear();
-	for (auto& [type, entityList] : m_entityMap) {
+	for (auto& entityList : m_entityMap) {
 		entityList.clear();
 	}
 	m_toAdd.clear();
+	m_toDestroy.clear();
+	m_registry.clear();
+}
+
+void EntityManager::addToList(std::vector<EntityHandle>& entityList, Entity* entity, size_t slot) {
+	entity->m_listIndices[slot] = entityList.size();
+	entityList.push_back(entity->getHandle());
 }
 
-void EntityManager::removeDestroyedEntities(std::vector<std::shared_ptr<Entity>>& entityList) {
-	entityList.erase(std::remove_if(entityList.begin(), entityList.end(),
-		[](const std::shared_ptr<Entity>& entity) {return entity->isDestroyed(); }),
-		entityList.end());
+// Swap the entity with the last entity of the list and pop it
+// 'slot' selects the index of the list in Entity::m_listIndices
+void EntityManager::removeFromList(std::vector<EntityHandle>& entityList, Entity* entity, size_t slot) {
+	size_t index = entity->m_listIndices[slot];
+	entity->m_listIndices[slot] = Entity::npos;
+	if (index != entityList.size() - 1) {
+		entityList[index] = entityList.back();
+		m_slots[entityList[index].getIndex()].m_listIndices[slot] = index;
+	}
+	entityList.pop_back();
 }
 
-size_t EntityManager::getNextID() {
-	return m_entityID++;
+// Invalidate the handles to the entity and recycle its slot
+void EntityManager::releaseSlot(Entity* entity) {
+	entity->m_generation = (entity->m_generation + 1) & EntityHandle::GenerationMask;
+	entity->m_toDestroy = true;
+	entity->m_listIndices.fill(Entity::npos);
+	m_freeIndices.push_back(entity->m_index);
 }
 
 // delayed add - to avoid iterator invalidation
-std::shared_ptr<Entity> EntityManager::addEntity() {
-	auto entity = std::shared_ptr<Entity>(new Entity(getNextID()));
+// The returned entity stays at the same address until it is removed
+Entity* EntityManager::addEntity() {
+	Entity* entity = acquireSlot();
 	m_toAdd.push_back(entity);
 	return entity;
 }
 
-std::vector<std::shared_ptr<Entity>>& EntityManager::getEntities() {
+// Reuse a free slot or append a new one
+Entity* EntityManager::acquireSlot() {
+	Entity* entity;
+	if (!m_freeIndices.empty()) {
+		entity = &m_slots[m_freeIndices.back()];
+		m_freeIndices.pop_back();
+		entity->m_toDestroy = false;
+	}
+	else {
+		if (m_slots.size() >= EntityHandle::IndexMask)
+			throw std::length_error("Too many entities");
+		entity = &m_slots.emplace_back(Entity(static_cast<uint32_t>(m_slots.size()), this, &m_registry));
+	}
+	return entity;
+}
+
+// O(1) check whether the handle refers to an entity that has not been removed
+bool EntityManager::isValid(EntityHandle handle) const {
+	uint32_t index = handle.getIndex();
+	return !handle.isNull() && index < m_slots.size() && m_slots[index].m_generation == handle.getGeneration();
+}
+
+// Returns nullptr if the handle is stale
+Entity* EntityManager::getEntity(EntityHandle handle) {
+	if (!isValid(handle))
+		return nullptr;
+	return &m_slots[handle.getIndex()];
+}
+
+std::vector<EntityHandle>& EntityManager::getEntities() {
 	return m_entities;
 }
-std::vector<std::shared_ptr<Entity>>& EntityManager::getEntities(ComponentType type) {
-	return m_entityMap[type];
-}
\ No newline at end of file
+std::vector<EntityHandle>& EntityManager::getEntities(ComponentType type) {
+	return m_entityMap[static_cast<size_t>(type)];
+}
@@ -1,20 +1,64 @@
 #pragma once
 #include "Entity.hpp"
+#include "View.hpp"
 #include <vector>
+#include <deque>
 #include <memory>
-#include <unordered_map>
+#include <array>
 class EntityManager {
-	std::vector<std::shared_ptr<Entity>> m_entities;
-	std::unordered_map<ComponentType, std::vector<std::shared_ptr<Entity>>> m_entityMap;
-	std::vector<std::shared_ptr<Entity>> m_toAdd;
-	size_t m_entityID = 0;
-	void removeDestroyedEntities(std::vector<std::shared_ptr<Entity>>& entityList);
+	friend class Entity;
+	// Entity slots, a deque keeps the entities in place when it grows
+	std::deque<Entity> m_slots;
+	std::vector<uint32_t> m_freeIndices;
+	std::vector<EntityHandle> m_entities;
+	std::array<std::vector<EntityHandle>, ComponentTypeCount> m_entityMap;
+	std::vector<Entity*> m_toAdd;
+	std::vector<Entity*> m_toDestroy;
+	ComponentRegistry m_registry;
+	static constexpr size_t allEntitiesSlot = ComponentTypeCount;
+	void addToList(std::vector<EntityHandle>& entityList, Entity* entity, size_t slot);
+	void removeFromList(std::vector<EntityHandle>& entityList, Entity* entity, size_t slot);
+	void releaseSlot(Entity* entity);
+	Entity* acquireSlot();
 public:
 	EntityManager();
+	EntityManager(const EntityManager&) = delete;
+	EntityManager& operator=(const EntityManager&) = delete;
 	void update();
 	void clear();
-	size_t getNextID();
-	std::shared_ptr<Entity> addEntity();
-	std::vector<std::shared_ptr<Entity>>& getEntities();
-	std::vector<std::shared_ptr<Entity>>& getEntities(ComponentType type);
+	Entity* addEntity();
+	bool isValid(EntityHandle handle) const;
+	Entity* getEntity(EntityHandle handle);
+	template <class T> T* getComponent(EntityHandle handle);
+	std::vector<EntityHandle>& getEntities();
+	std::vector<EntityHandle>& getEntities(ComponentType type);
+	template <class T> std::vector<T>& getComponents();
+	template <class T> ComponentPool<T>& getPool();
+	template <class... Ts> View<Ts...> view();
 };
+
+// Returns nullptr if the handle is stale or the entity does not have the component
+template <class T>
+T* EntityManager::getComponent(EntityHandle handle) {
+	if (!isValid(handle))
+		return nullptr;
+	return m_registry.getPool<T>().get(handle.getIndex());
+}
+
+// Contiguous array of every component of type T
+template <class T>
+std::vector<T>& EntityManager::getComponents() {
+	return m_registry.getPool<T>().getComponents();
+}
+
+template <class T>
+ComponentPool<T>& EntityManager::getPool() {
+	return m_registry.getPool<T>();
+}
+
+// Entities that have every component in Ts, see View
+template <class... Ts>
+View<Ts...> EntityManager::view() {
+	static_assert(sizeof...(Ts) > 0, "A view needs at least one component type");
+	return View<Ts...>(m_slots, m_registry.getPool<Ts>()...);
+}
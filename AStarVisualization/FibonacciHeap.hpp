@@ -23,9 +23,11 @@ private:
 	};
 
 	// Private members
-	Node* m_top;
+	Node* m_top{ nullptr };
 	size_t m_size{ 0 };
 public:
+	// Bytes allocated per element in the heap
+	static constexpr size_t NodeSize = sizeof(Node);
 	// Handle class for the remove and decreaseKey operations
 	class Handle {
 	private:
@@ -39,6 +41,8 @@ public:
 	// Constructor & Destructor
 	FibonacciHeap() = default;
 	~FibonacciHeap() { if (m_top) recursiveFree(m_top); }
+	FibonacciHeap(const FibonacciHeap&) = delete;
+	FibonacciHeap& operator=(const FibonacciHeap&) = delete;
 	// Operations
 	D top() const;
 	Handle push(float key, D data);
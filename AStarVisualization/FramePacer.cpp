@@ -0,0 +1,25 @@
+#include "FramePacer.hpp"
+#include <thread>
+
+FramePacer::FramePacer(std::chrono::nanoseconds period, std::chrono::nanoseconds spinTime)
+	: m_period(period), m_spinTime(spinTime), m_deadline(Clock::now() + period) {}
+
+// Block until the end of the current frame period
+void FramePacer::wait() {
+	auto now = Clock::now();
+	if (now >= m_deadline) {
+		// Overran, drop the missed deadlines
+		m_deadline = (now - m_deadline > m_period) ? now + m_period : m_deadline + m_period;
+		return;
+	}
+	if (m_deadline - now > m_spinTime)
+		std::this_thread::sleep_for(m_deadline - now - m_spinTime);
+	while (Clock::now() < m_deadline)
+		std::this_thread::yield();
+	m_deadline += m_period;
+}
+
+// Start a new schedule from now, e.g. after blocking on input
+void FramePacer::resync() {
+	m_deadline = Clock::now() + m_period;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <chrono>
+
+// Paces frames to a fixed period with a hybrid sleep and spin wait
+// The OS sleep is only accurate to a millisecond or worse, so the pacer sleeps until spinTime
+// before the deadline and yields in a loop for the rest. Deadlines advance by whole periods,
+// a frame that overran by more than a period starts a new schedule instead of bursting to catch up.
+class FramePacer
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	FramePacer(std::chrono::nanoseconds period, std::chrono::nanoseconds spinTime);
+	void wait();
+	void resync();
+private:
+	std::chrono::nanoseconds m_period;
+	std::chrono::nanoseconds m_spinTime;
+	Clock::time_point m_deadline;
+};
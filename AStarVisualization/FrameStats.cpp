@@ -0,0 +1,45 @@
+#include "FrameStats.hpp"
+#include <algorithm>
+
+// Durations of the same phase within a frame add up
+void FrameStats::record(Phase phase, std::chrono::nanoseconds duration) {
+	size_t index = static_cast<size_t>(phase);
+	m_current.durations[index] += std::chrono::duration<double, std::milli>(duration).count();
+	m_current.recorded[index] = true;
+}
+
+void FrameStats::endFrame() {
+	if (m_samples.size() < WindowSize)
+		m_samples.push_back(m_current);
+	else
+		m_samples[m_next] = m_current;
+	m_next = (m_next + 1) % WindowSize;
+	m_current = {};
+}
+
+// Milliseconds, percentile in [0, 100], 0 if no buffered frame recorded the phase
+double FrameStats::getPercentile(Phase phase, double percentile) const {
+	size_t index = static_cast<size_t>(phase);
+	std::vector<double> values;
+	values.reserve(m_samples.size());
+	for (auto& sample : m_samples) {
+		if (sample.recorded[index])
+			values.push_back(sample.durations[index]);
+	}
+	if (values.empty())
+		return 0;
+	size_t rank = static_cast<size_t>(std::clamp(percentile, 0.0, 100.0) / 100.0 * (values.size() - 1) + 0.5);
+	std::nth_element(values.begin(), values.begin() + rank, values.end());
+	return values[rank];
+}
+
+// Buffered frames
+size_t FrameStats::getSampleCount() const {
+	return m_samples.size();
+}
+
+// Buffered frames that recorded the phase
+size_t FrameStats::getSampleCount(Phase phase) const {
+	size_t index = static_cast<size_t>(phase);
+	return std::count_if(m_samples.begin(), m_samples.end(), [index](const Sample& sample) { return sample.recorded[index]; });
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <chrono>
+#include <array>
+#include <vector>
+
+// Timings of the last WindowSize frames
+// Each frame records the duration of its phases and endFrame commits them to a ring buffer,
+// getPercentile reports a percentile of one phase over the buffered frames that recorded it,
+// so frames that skip rendering do not count as 0 ms renders.
+class FrameStats
+{
+public:
+	enum class Phase {
+		UPDATE,		// input and scene update
+		RENDER,		// redraw of the dirty regions
+		PRESENT,	// composite and display
+		FRAME		// whole frame including the pacing wait
+	};
+	static constexpr size_t PhaseCount = 4;
+	static constexpr size_t WindowSize = 512;
+	void record(Phase phase, std::chrono::nanoseconds duration);
+	void endFrame();
+	double getPercentile(Phase phase, double percentile) const;
+	size_t getSampleCount() const;
+	size_t getSampleCount(Phase phase) const;
+private:
+	struct Sample {
+		std::array<double, PhaseCount> durations{};
+		std::array<bool, PhaseCount> recorded{};
+	};
+	std::vector<Sample> m_samples;
+	size_t m_next{ 0 };
+	Sample m_current{};
+};
@@ -1,43 +1,99 @@
 #include "GameSystem.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <cstdio>
 
 
 void GameSystem::render() {
 	PROFILE_FUNCTION();
-	if (m_curScene->getNeedRender()) {
+	auto& dirtyRegion = m_curScene->getDirtyRegion();
+	if (!dirtyRegion.empty()) {
+		auto renderStart = m_clock.now();
 		{
 			PROFILE_SCOPE("Render::draw");
-			m_window.clear();
-			auto manager = m_curScene->getManager();
-			// Draw Shapes
-			for (auto& entity : manager->getEntities(ComponentType::SHAPE)) {
-				auto cShape = entity->getComponent<CShape>();
-				m_window.draw(cShape->vertexArray, cShape->states);
-			}
-			// Draw Texts
-			for (auto& entity : manager->getEntities(ComponentType::TEXT)) {
-				auto cText = entity->getComponent<CText>();
-				m_window.draw(cText->text, cText->states);
+			auto size = m_canvas.getSize();
+			if (dirtyRegion.isAll())
+				redraw(sf::FloatRect(0, 0, size.x, size.y));
+			else {
+				for (auto& rect : dirtyRegion.getRects())
+					redraw(rect);
 			}
+			dirtyRegion.clear();
+			m_canvas.display();
 		}
+		auto presentStart = m_clock.now();
+		m_frameStats.record(FrameStats::Phase::RENDER, presentStart - renderStart);
 		{	
 			PROFILE_SCOPE("Render::display");
+			// Composite the canvas to the window
+			m_window.clear();
+			m_window.draw(sf::Sprite(m_canvas.getTexture()));
 			m_window.display();
 		}
+		m_frameStats.record(FrameStats::Phase::PRESENT, m_clock.now() - presentStart);
 	}
 }
 
+// Redraw a region of the canvas
+// The view maps the region onto the same pixels of the canvas, its viewport clips everything outside of them.
+void GameSystem::redraw(const sf::FloatRect& region) {
+	auto size = m_canvas.getSize();
+	// Snap to whole pixels inside the canvas so neighbouring regions do not leave seams
+	float left = std::max(std::floor(region.left), 0.f);
+	float top = std::max(std::floor(region.top), 0.f);
+	float right = std::min(std::ceil(region.left + region.width), static_cast<float>(size.x));
+	float bottom = std::min(std::ceil(region.top + region.height), static_cast<float>(size.y));
+	if (right <= left || bottom <= top)
+		return;
+	sf::FloatRect pixels(left, top, right - left, bottom - top);
+	m_canvas.setView(DirtyRegion::getClipView(size, pixels));
+
+	// Clear the region, clear() would clear the whole canvas
+	sf::RectangleShape background(sf::Vector2f(pixels.width, pixels.height));
+	background.setPosition(left, top);
+	background.setFillColor(sf::Color::Black);
+	m_canvas.draw(background);
+
+	auto manager = m_curScene->getManager();
+	m_curScene->draw(m_canvas, pixels);
+	// Draw Shapes
+	manager->view<CShape>().each([&](CShape& cShape) {
+		if (cShape.states.transform.transformRect(cShape.vertexArray.getBounds()).intersects(pixels))
+			m_canvas.draw(cShape.vertexArray, cShape.states);
+		});
+	// Draw Texts
+	manager->view<CText>().each([&](CText& cText) {
+		if (cText.states.transform.transformRect(cText.text.getGlobalBounds()).intersects(pixels))
+			m_canvas.draw(cText.text, cText.states);
+		});
+	m_canvas.setView(m_canvas.getDefaultView());
+}
+
 void GameSystem::handleUserInput() {
 	PROFILE_FUNCTION();
 	sf::Event event;
 	while (m_window.pollEvent(event))
-	{	
-		if (event.type == sf::Event::Closed)
-			m_window.close();
-		// Let the current scent to handle user inputs
-		m_curScene->handleKeyBoardInput(event);
-		m_curScene->handleMouseInput(event);
-	}
-	
+		handleEvent(event);
+}
+
+void GameSystem::handleEvent(sf::Event& event) {
+	if (event.type == sf::Event::Closed)
+		m_window.close();
+	// Start or stop recording the profile
+	else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F9)
+		prof::Profiler::setEnabled(!prof::Profiler::isEnabled());
+	// Let the current scent to handle user inputs
+	m_curScene->handleKeyBoardInput(event);
+	m_curScene->handleMouseInput(event);
+}
+
+// Block until the window receives an event, the process uses no CPU meanwhile
+void GameSystem::waitForEvent() {
+	PROFILE_FUNCTION();
+	sf::Event event;
+	if (m_window.waitEvent(event))
+		handleEvent(event);
 }
 
 void GameSystem::update() {
@@ -45,6 +101,7 @@ void GameSystem::update() {
 	auto manager = m_curScene->getManager();
 	manager->update();
 	m_curScene->update(m_window);
+	PROFILE_COUNTER("Entities", manager->getEntities().size());
 }
 
 void GameSystem::setScene(std::unique_ptr<Scene>&& scene) {
@@ -52,30 +109,57 @@ void GameSystem::setScene(std::unique_ptr<Scene>&& scene) {
 	m_curScene->init();
 }
 
-GameSystem::GameSystem() : m_config(GameConfig::instance()), m_window(sf::VideoMode(m_config.windowWidth, m_config.widowHeight), m_config.windowName.c_str())
+GameSystem::GameSystem() : m_config(GameConfig::instance()), m_window(sf::VideoMode(m_config.windowWidth, m_config.widowHeight), m_config.windowName.c_str()),
+	m_pacer(std::chrono::nanoseconds(std::chrono::seconds(1)) / m_config.frameRate, m_config.pacerSpinTime)
 {
-	m_window.setFramerateLimit(m_config.frameRate);
+	prof::Profiler::setEnabled(m_config.profileOnStart);
+	if (!m_canvas.create(m_config.windowWidth, m_config.widowHeight))
+		throw std::runtime_error("Failed to create the render texture");
 	setScene(std::make_unique<MainScene>());
 }
 
 void GameSystem::wait() {
 	PROFILE_FUNCTION();
-	using namespace std::chrono_literals;
-	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(m_clock.now() - m_loopStartTime);
-	auto remainingTime = std::chrono::milliseconds(m_config.miliPerFrame) - elapsed;
-	if (remainingTime > std::chrono::milliseconds(0)) {
-		std::this_thread::sleep_for(remainingTime);
-	}
+	m_pacer.wait();
+}
+
+void GameSystem::showFrameStats() {
+	using Phase = FrameStats::Phase;
+	char title[256];
+	std::snprintf(title, sizeof(title), "%s | update p50 %.2f p99 %.2f | render p50 %.2f p99 %.2f | present p50 %.2f p99 %.2f in %zu of %zu frames | frame p50 %.2f p99 %.2f ms",
+		m_config.windowName.c_str(),
+		m_frameStats.getPercentile(Phase::UPDATE, 50), m_frameStats.getPercentile(Phase::UPDATE, 99),
+		m_frameStats.getPercentile(Phase::RENDER, 50), m_frameStats.getPercentile(Phase::RENDER, 99),
+		m_frameStats.getPercentile(Phase::PRESENT, 50), m_frameStats.getPercentile(Phase::PRESENT, 99),
+		m_frameStats.getSampleCount(Phase::RENDER), m_frameStats.getSampleCount(),
+		m_frameStats.getPercentile(Phase::FRAME, 50), m_frameStats.getPercentile(Phase::FRAME, 99));
+	m_window.setTitle(title);
+}
+
+const FrameStats& GameSystem::getFrameStats() const {
+	return m_frameStats;
 }
 
 void GameSystem::run() {
 	while (m_window.isOpen())
 	{
 		PROFILE_SCOPE("Game Loop");
+		// Nothing to animate or draw, sleep until the user does something
+		if (!m_curScene->isAnimating() && m_curScene->getDirtyRegion().empty()) {
+			waitForEvent();
+			m_pacer.resync();
+		}
 		m_loopStartTime = m_clock.now();
 		handleUserInput();
 		update();
+		m_frameStats.record(FrameStats::Phase::UPDATE, m_clock.now() - m_loopStartTime);
 		render();
 		wait();
+		m_frameStats.record(FrameStats::Phase::FRAME, m_clock.now() - m_loopStartTime);
+		m_frameStats.endFrame();
+		if (m_config.showFrameStats && m_clock.now() - m_lastStatsTime > std::chrono::seconds(1)) {
+			m_lastStatsTime = m_clock.now();
+			showFrameStats();
+		}
 	}
-}
\ No newline at end of file
+}
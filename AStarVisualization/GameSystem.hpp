@@ -1,6 +1,8 @@
 #pragma once
 #include "MainScene.hpp"
 #include "Profiler.hpp"
+#include "FramePacer.hpp"
+#include "FrameStats.hpp"
 #include <chrono>
 #include <thread>
 
@@ -8,16 +10,26 @@ class GameSystem
 {
 	GameConfig& m_config;
 	sf::RenderWindow m_window;
+	// Persistent frame, only the dirty regions of the scene are redrawn into it
+	sf::RenderTexture m_canvas;
 	std::unique_ptr<Scene> m_curScene;
 	std::chrono::steady_clock m_clock;
 	std::chrono::steady_clock::time_point m_loopStartTime;
+	FramePacer m_pacer;
+	FrameStats m_frameStats;
+	std::chrono::steady_clock::time_point m_lastStatsTime;
 	void render();
+	void redraw(const sf::FloatRect& region);
 	void update();
 	void setScene(std::unique_ptr<Scene>&& scene);
 	void handleUserInput();
+	void handleEvent(sf::Event& event);
+	void waitForEvent();
 	void wait();
+	void showFrameStats();
 public:
 	GameSystem();
 	void run();
+	const FrameStats& getFrameStats() const;
 };
 
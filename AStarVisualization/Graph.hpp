@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <cstddef>
 // N : vertex attribute
 // D : edge attribute
 template <class N, class D = float>
@@ -0,0 +1,290 @@
+#pragma once
+#include "AdjacencyListGraph.hpp"
+#include <vector>
+#include <string>
+#include <istream>
+#include <fstream>
+#include <cstdint>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+#include <exception>
+#include <algorithm>
+
+// Obstacle grid of a map, the id of the cell (x, y) is x + width * y
+class GridMap
+{
+public:
+	GridMap() = default;
+	GridMap(size_t width, size_t height);
+	static GridMap loadMovingAI(std::istream& in);
+	static GridMap loadMovingAI(const std::string& fileName, size_t numThreads = 0);
+	static GridMap loadPGM(const std::string& fileName, size_t numThreads = 0);
+	static GridMap load(const std::string& fileName, size_t numThreads = 0);
+	size_t getWidth() const;
+	size_t getHeight() const;
+	size_t getCell(size_t x, size_t y) const;
+	bool isBlocked(size_t cell) const;
+	void setBlocked(size_t cell, bool blocked);
+	const std::vector<uint8_t>& getObstacles() const;
+	std::vector<uint8_t> releaseObstacles();
+	template <class Vertex>
+	AdjacencyListGraph<Vertex> buildGraph(bool diagonal) const;
+private:
+	size_t m_width{ 0 }, m_height{ 0 };
+	// 1 if the cell is an obstacle
+	std::vector<uint8_t> m_obstacles;
+	// Bytes read at once by a loading thread
+	static constexpr size_t ReadBlockSize = size_t(1) << 20;
+	static void readMovingAIHeader(std::istream& in, size_t& width, size_t& height);
+	void parseMovingAIRow(size_t y, const char* row);
+	template <class ParseRow>
+	static void parseRows(const std::string& fileName, std::streamoff dataStart, size_t stride, size_t rowSize, size_t height,
+		size_t numThreads, ParseRow&& parseRow);
+};
+
+inline GridMap::GridMap(size_t width, size_t height)
+	: m_width(width), m_height(height), m_obstacles(width * height, 0) {}
+
+// Read a map in the MovingAI benchmark format
+// "type octile", "height H", "width W" and "map" lines followed by H rows of W terrain characters,
+// '.', 'G' and 'S' are passable, everything else is an obstacle.
+inline GridMap GridMap::loadMovingAI(std::istream& in) {
+	size_t width, height;
+	readMovingAIHeader(in, width, height);
+	GridMap map(width, height);
+	std::string row;
+	for (size_t y = 0; y < height; ++y) {
+		if (!(in >> row) || row.size() != width)
+			throw std::runtime_error("MovingAI map row " + std::to_string(y) + " does not have " + std::to_string(width) + " cells");
+		map.parseMovingAIRow(y, row.data());
+	}
+	return map;
+}
+
+// Stream a MovingAI map file row by row, the text is never held in memory as a whole
+// Rows of equal length are parsed in parallel, each thread reads its own block of rows,
+// numThreads 0 uses every hardware thread. Other files are parsed sequentially.
+inline GridMap GridMap::loadMovingAI(const std::string& fileName, size_t numThreads) {
+	std::ifstream in(fileName, std::ios::binary);
+	if (!in)
+		throw std::runtime_error("Can not open " + fileName);
+	size_t width, height;
+	readMovingAIHeader(in, width, height);
+	// Skip the rest of the "map" line
+	std::string line;
+	std::getline(in, line);
+	std::streamoff dataStart = in.tellg();
+	// Every row must end with the line ending of the first row
+	std::getline(in, line);
+	bool carriageReturn = !line.empty() && line.back() == '\r';
+	size_t stride = width + (carriageReturn ? 2 : 1);
+	in.seekg(0, std::ios::end);
+	std::streamoff fileSize = in.tellg();
+	std::streamoff dataSize = fileSize - dataStart;
+	// The last row may miss its line ending
+	bool uniformRows = line.size() == stride - 1 && dataSize >= static_cast<std::streamoff>(stride * (height - 1) + width)
+		&& dataSize <= static_cast<std::streamoff>(stride * height);
+	if (!uniformRows) {
+		in.clear();
+		in.seekg(0);
+		return loadMovingAI(in);
+	}
+	GridMap map(width, height);
+	parseRows(fileName, dataStart, stride, width, height, numThreads, [&map, width, height](size_t y, const char* row) {
+		if (y + 1 < height && row[width] != '\r' && row[width] != '\n')
+			throw std::runtime_error("MovingAI map row " + std::to_string(y) + " does not have " + std::to_string(width) + " cells");
+		map.parseMovingAIRow(y, row);
+		});
+	return map;
+}
+
+// Stream a binary PGM (P5) image, pixels darker than half of the maximum value are obstacles
+// Rows are parsed in parallel like loadMovingAI.
+inline GridMap GridMap::loadPGM(const std::string& fileName, size_t numThreads) {
+	std::ifstream in(fileName, std::ios::binary);
+	if (!in)
+		throw std::runtime_error("Can not open " + fileName);
+	// The header is "P5 width height maxValue" separated by whitespace and '#' comments
+	std::string fields[4];
+	for (auto& field : fields) {
+		while (in >> std::ws && in.peek() == '#')
+			std::getline(in, field);
+		if (!(in >> field))
+			throw std::runtime_error("Invalid PGM header in " + fileName);
+	}
+	if (fields[0] != "P5")
+		throw std::runtime_error(fileName + " is not a binary PGM image");
+	size_t width = std::stoul(fields[1]), height = std::stoul(fields[2]);
+	unsigned long maxValue = std::stoul(fields[3]);
+	if (width == 0 || height == 0 || maxValue == 0 || maxValue > 65535)
+		throw std::runtime_error("Invalid PGM header in " + fileName);
+	// A single whitespace character separates the header from the pixels
+	in.get();
+	std::streamoff dataStart = in.tellg();
+	size_t bytesPerPixel = maxValue < 256 ? 1 : 2;
+	size_t stride = width * bytesPerPixel;
+	in.seekg(0, std::ios::end);
+	if (in.tellg() - dataStart < static_cast<std::streamoff>(stride * height))
+		throw std::runtime_error(fileName + " has fewer pixels than its header says");
+	GridMap map(width, height);
+	parseRows(fileName, dataStart, stride, stride, height, numThreads, [&map, width, bytesPerPixel, maxValue](size_t y, const char* row) {
+		auto pixels = reinterpret_cast<const unsigned char*>(row);
+		uint8_t* obstacles = map.m_obstacles.data() + width * y;
+		for (size_t x = 0; x < width; ++x) {
+			// 16 bit pixels are big endian
+			unsigned long value = bytesPerPixel == 1 ? pixels[x] : (pixels[2 * x] << 8) | pixels[2 * x + 1];
+			obstacles[x] = 2 * value < maxValue ? 1 : 0;
+		}
+		});
+	return map;
+}
+
+// Load a MovingAI map or a PGM image, told apart by their first bytes
+inline GridMap GridMap::load(const std::string& fileName, size_t numThreads) {
+	std::ifstream in(fileName, std::ios::binary);
+	if (!in)
+		throw std::runtime_error("Can not open " + fileName);
+	char magic[2] = {};
+	in.read(magic, 2);
+	if (magic[0] == 'P' && magic[1] == '5')
+		return loadPGM(fileName, numThreads);
+	return loadMovingAI(fileName, numThreads);
+}
+
+inline void GridMap::readMovingAIHeader(std::istream& in, size_t& width, size_t& height) {
+	std::string key, type;
+	width = 0, height = 0;
+	while (in >> key && key != "map") {
+		if (key == "type")
+			in >> type;
+		else if (key == "height")
+			in >> height;
+		else if (key == "width")
+			in >> width;
+		else
+			throw std::runtime_error("Unknown MovingAI map header: " + key);
+	}
+	if (key != "map" || width == 0 || height == 0)
+		throw std::runtime_error("Invalid MovingAI map header");
+}
+
+inline void GridMap::parseMovingAIRow(size_t y, const char* row) {
+	uint8_t* obstacles = m_obstacles.data() + m_width * y;
+	for (size_t x = 0; x < m_width; ++x) {
+		char terrain = row[x];
+		obstacles[x] = terrain == '.' || terrain == 'G' || terrain == 'S' ? 0 : 1;
+	}
+}
+
+// Call parseRow(y, row) for every row of a file whose rows are stride bytes apart from dataStart
+// A row holds rowSize bytes of data followed by separators, the last row may miss its separators. The rows are split into one contiguous block per thread, a thread reads ReadBlockSize bytes at a time.
+template <class ParseRow>
+void GridMap::parseRows(const std::string& fileName, std::streamoff dataStart, size_t stride, size_t rowSize, size_t height,
+	size_t numThreads, ParseRow&& parseRow) {
+	if (numThreads == 0)
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	numThreads = std::min(numThreads, height);
+	std::vector<std::exception_ptr> errors(numThreads);
+	auto parseBlock = [&](size_t thread) {
+		try {
+			size_t begin = height * thread / numThreads, end = height * (thread + 1) / numThreads;
+			std::ifstream in(fileName, std::ios::binary);
+			in.seekg(dataStart + static_cast<std::streamoff>(stride * begin));
+			size_t rowsPerRead = std::max<size_t>(1, ReadBlockSize / stride);
+			std::vector<char> buffer(std::min(rowsPerRead, end - begin) * stride);
+			for (size_t y = begin; y < end; y += rowsPerRead) {
+				size_t rows = std::min(rowsPerRead, end - y);
+				in.read(buffer.data(), rows * stride);
+				if (static_cast<size_t>(in.gcount()) < (rows - 1) * stride + rowSize)
+					throw std::runtime_error(fileName + " ends before row " + std::to_string(y + rows));
+				for (size_t row = 0; row < rows; ++row)
+					parseRow(y + row, buffer.data() + row * stride);
+			}
+		}
+		catch (...) {
+			errors[thread] = std::current_exception();
+		}
+	};
+	std::vector<std::thread> threads;
+	for (size_t thread = 1; thread < numThreads; ++thread)
+		threads.emplace_back(parseBlock, thread);
+	parseBlock(0);
+	for (auto& thread : threads)
+		thread.join();
+	for (auto& error : errors) {
+		if (error)
+			std::rethrow_exception(error);
+	}
+}
+
+inline size_t GridMap::getWidth() const {
+	return m_width;
+}
+
+inline size_t GridMap::getHeight() const {
+	return m_height;
+}
+
+inline size_t GridMap::getCell(size_t x, size_t y) const {
+	return x + m_width * y;
+}
+
+inline bool GridMap::isBlocked(size_t cell) const {
+	return m_obstacles[cell] != 0;
+}
+
+inline void GridMap::setBlocked(size_t cell, bool blocked) {
+	m_obstacles[cell] = blocked ? 1 : 0;
+}
+
+inline const std::vector<uint8_t>& GridMap::getObstacles() const {
+	return m_obstacles;
+}
+
+// Move the obstacles out, the map is empty afterwards
+inline std::vector<uint8_t> GridMap::releaseObstacles() {
+	m_width = m_height = 0;
+	return std::move(m_obstacles);
+}
+
+// Build the graph of the passable cells, a vertex position is (y, x) like the cells of MainScene
+// Cells are connected to their 4 neighbors with weight 1,
+// and with diagonal to their diagonal neighbors with weight sqrt(2) unless the move cuts a corner.
+template <class Vertex>
+AdjacencyListGraph<Vertex> GridMap::buildGraph(bool diagonal) const {
+	AdjacencyListGraph<Vertex> graph(m_width * m_height);
+	const float diagonalWeight = std::sqrt(2.f);
+	auto isFree = [this](size_t x, size_t y) {
+		return x < m_width && y < m_height && !isBlocked(getCell(x, y));
+	};
+	for (size_t y = 0; y < m_height; ++y) {
+		for (size_t x = 0; x < m_width; ++x) {
+			size_t cur = getCell(x, y);
+			graph.getVertexAttribute(cur).pos = { static_cast<float>(y), static_cast<float>(x) };
+			if (isBlocked(cur))
+				continue;
+			// size_t wraps around below 0, isFree rejects it
+			bool left = isFree(x - 1, y), right = isFree(x + 1, y), up = isFree(x, y - 1), down = isFree(x, y + 1);
+			if (left)
+				graph.addEdge(cur, cur - 1, 1);
+			if (right)
+				graph.addEdge(cur, cur + 1, 1);
+			if (up)
+				graph.addEdge(cur, cur - m_width, 1);
+			if (down)
+				graph.addEdge(cur, cur + m_width, 1);
+			if (!diagonal)
+				continue;
+			if (left && up && isFree(x - 1, y - 1))
+				graph.addEdge(cur, cur - m_width - 1, diagonalWeight);
+			if (right && up && isFree(x + 1, y - 1))
+				graph.addEdge(cur, cur - m_width + 1, diagonalWeight);
+			if (left && down && isFree(x - 1, y + 1))
+				graph.addEdge(cur, cur + m_width - 1, diagonalWeight);
+			if (right && down && isFree(x + 1, y + 1))
+				graph.addEdge(cur, cur + m_width + 1, diagonalWeight);
+		}
+	}
+	return graph;
+}
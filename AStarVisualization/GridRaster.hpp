@@ -0,0 +1,55 @@
+#pragma once
+#include <cmath>
+#include <limits>
+
+// Rasterization of shapes onto the cells of a grid, in cell coordinates
+// Cell (x, y) is the unit square [x, x + 1) x [y, y + 1).
+namespace GridRaster {
+
+	// Visit every cell the segment from (x0, y0) to (x1, y1) touches, in order (supercover DDA)
+	// When the segment passes exactly through a cell corner, both cells beside the corner are visited too,
+	// so no cell on the segment is missed. visit(x, y) may see out of grid cells.
+	template <class Visit>
+	void traverseSegment(float x0, float y0, float x1, float y1, Visit&& visit) {
+		constexpr float infinity = std::numeric_limits<float>::infinity();
+		int x = static_cast<int>(std::floor(x0)), y = static_cast<int>(std::floor(y0));
+		int endX = static_cast<int>(std::floor(x1)), endY = static_cast<int>(std::floor(y1));
+		float dx = x1 - x0, dy = y1 - y0;
+		int stepX = (dx > 0) - (dx < 0), stepY = (dy > 0) - (dy < 0);
+		// Segment parameter of the next vertical and horizontal cell border and the distance between borders
+		float tDeltaX = stepX ? 1.f / std::abs(dx) : infinity;
+		float tDeltaY = stepY ? 1.f / std::abs(dy) : infinity;
+		float tMaxX = stepX > 0 ? (x + 1 - x0) * tDeltaX : stepX < 0 ? (x0 - x) * tDeltaX : infinity;
+		float tMaxY = stepY > 0 ? (y + 1 - y0) * tDeltaY : stepY < 0 ? (y0 - y) * tDeltaY : infinity;
+		visit(x, y);
+		while (x != endX || y != endY) {
+			bool stepInX = y == endY || (x != endX && tMaxX < tMaxY);
+			bool stepInY = x == endX || (y != endY && tMaxY < tMaxX);
+			if (!stepInX && !stepInY) {
+				// Through a corner
+				visit(x + stepX, y);
+				visit(x, y + stepY);
+				stepInX = stepInY = true;
+			}
+			if (stepInX) {
+				x += stepX;
+				tMaxX += tDeltaX;
+			}
+			if (stepInY) {
+				y += stepY;
+				tMaxY += tDeltaY;
+			}
+			visit(x, y);
+		}
+	}
+
+	// Visit the cells whose centers are within radius cells of the center of cell (x, y)
+	template <class Visit>
+	void stampDisc(int x, int y, int radius, Visit&& visit) {
+		for (int offsetY = -radius; offsetY <= radius; ++offsetY) {
+			int halfWidth = static_cast<int>(std::sqrt(static_cast<float>(radius * radius - offsetY * offsetY)));
+			for (int offsetX = -halfWidth; offsetX <= halfWidth; ++offsetX)
+				visit(x + offsetX, y + offsetY);
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#include "GridRenderer.hpp"
+#include <algorithm>
+
+// Rebuild the chunks for a new grid, every cell gets the same color
+// Cell (i, j) is the square of side cellSize - cellGap at origin + (j, i) * cellSize, its cell id is j + cols * i.
+void GridRenderer::reset(size_t rows, size_t cols, sf::Vector2f origin, float cellSize, float cellGap, sf::Color color) {
+	m_rows = rows;
+	m_cols = cols;
+	m_origin = origin;
+	m_cellSize = cellSize;
+	m_chunkCols = (cols + ChunkSize - 1) / ChunkSize;
+	size_t chunkRows = (rows + ChunkSize - 1) / ChunkSize;
+	m_chunks.clear();
+	m_chunks.resize(chunkRows * m_chunkCols);
+	// Fall back to client side vertex arrays if the driver has no vertex buffer support
+	m_useBuffers = sf::VertexBuffer::isAvailable();
+	float side = cellSize - cellGap;
+	for (size_t chunkRow = 0; chunkRow < chunkRows; ++chunkRow) {
+		for (size_t chunkCol = 0; chunkCol < m_chunkCols; ++chunkCol) {
+			auto& chunk = m_chunks[chunkCol + m_chunkCols * chunkRow];
+			size_t rowEnd = std::min(rows, (chunkRow + 1) * ChunkSize);
+			size_t colEnd = std::min(cols, (chunkCol + 1) * ChunkSize);
+			chunk.vertices.reserve((rowEnd - chunkRow * ChunkSize) * (colEnd - chunkCol * ChunkSize) * 4);
+			for (size_t i = chunkRow * ChunkSize; i < rowEnd; ++i) {
+				for (size_t j = chunkCol * ChunkSize; j < colEnd; ++j) {
+					float x = origin.x + j * cellSize, y = origin.y + i * cellSize;
+					chunk.vertices.emplace_back(sf::Vector2f(x, y), color);
+					chunk.vertices.emplace_back(sf::Vector2f(x + side, y), color);
+					chunk.vertices.emplace_back(sf::Vector2f(x + side, y + side), color);
+					chunk.vertices.emplace_back(sf::Vector2f(x, y + side), color);
+				}
+			}
+			chunk.bounds = sf::FloatRect(origin.x + chunkCol * ChunkSize * cellSize, origin.y + chunkRow * ChunkSize * cellSize,
+				(colEnd - chunkCol * ChunkSize) * cellSize, (rowEnd - chunkRow * ChunkSize) * cellSize);
+			if (m_useBuffers)
+				m_useBuffers = chunk.buffer.create(chunk.vertices.size());
+			chunk.dirty = true;
+		}
+	}
+}
+
+// Index of the chunk that holds the cell and of the cell's first vertex in the chunk
+size_t GridRenderer::locate(size_t cell, size_t& chunkIndex) const {
+	size_t i = cell / m_cols, j = cell % m_cols;
+	size_t chunkRow = i / ChunkSize, chunkCol = j / ChunkSize;
+	chunkIndex = chunkCol + m_chunkCols * chunkRow;
+	// The chunks of the last column may be narrower
+	size_t width = std::min(m_cols - chunkCol * ChunkSize, ChunkSize);
+	return ((j - chunkCol * ChunkSize) + width * (i - chunkRow * ChunkSize)) * 4;
+}
+
+// Returns true if the color of the cell changed
+bool GridRenderer::setColor(size_t cell, sf::Color color) {
+	size_t chunkIndex;
+	size_t first = locate(cell, chunkIndex);
+	auto& chunk = m_chunks[chunkIndex];
+	if (chunk.vertices[first].color == color)
+		return false;
+	for (size_t k = first; k < first + 4; ++k)
+		chunk.vertices[k].color = color;
+	chunk.dirty = true;
+	return true;
+}
+
+// Color every cell in one pass, setColor where states is not 0 and clearColor elsewhere
+void GridRenderer::setColors(const std::vector<uint8_t>& states, sf::Color clearColor, sf::Color setColor) {
+	for (size_t cell = 0; cell < m_rows * m_cols; ++cell) {
+		size_t chunkIndex;
+		size_t first = locate(cell, chunkIndex);
+		sf::Color color = states[cell] ? setColor : clearColor;
+		auto& vertices = m_chunks[chunkIndex].vertices;
+		for (size_t k = first; k < first + 4; ++k)
+			vertices[k].color = color;
+	}
+	for (auto& chunk : m_chunks)
+		chunk.dirty = true;
+}
+
+sf::Color GridRenderer::getColor(size_t cell) const {
+	size_t chunkIndex;
+	size_t first = locate(cell, chunkIndex);
+	return m_chunks[chunkIndex].vertices[first].color;
+}
+
+// Area covered by the cell, including its gap
+sf::FloatRect GridRenderer::getCellBounds(size_t cell) const {
+	size_t i = cell / m_cols, j = cell % m_cols;
+	return { m_origin.x + j * m_cellSize, m_origin.y + i * m_cellSize, m_cellSize, m_cellSize };
+}
+
+// Upload the dirty chunks and draw the chunks that overlap the region
+void GridRenderer::draw(sf::RenderTarget& target, const sf::FloatRect& region, const sf::RenderStates& states) {
+	for (auto& chunk : m_chunks) {
+		if (!chunk.bounds.intersects(region))
+			continue;
+		if (!m_useBuffers) {
+			target.draw(chunk.vertices.data(), chunk.vertices.size(), sf::Quads, states);
+			continue;
+		}
+		if (chunk.dirty) {
+			chunk.buffer.update(chunk.vertices.data());
+			chunk.dirty = false;
+		}
+		target.draw(chunk.buffer, states);
+	}
+}
+
+size_t GridRenderer::getChunkCount() const {
+	return m_chunks.size();
+}
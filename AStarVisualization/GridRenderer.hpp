@@ -0,0 +1,34 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+// Draws a rows x cols grid of colored cells from chunked vertex buffers
+// Each chunk of ChunkSize x ChunkSize cells keeps a CPU copy of its quads and a sf::VertexBuffer.
+// setColor only changes the CPU copy and marks the chunk dirty, draw uploads the dirty chunks
+// and issues one draw call per chunk, so a frame costs the number of chunks, not the number of cells.
+class GridRenderer
+{
+public:
+	static constexpr size_t ChunkSize = 64;
+	void reset(size_t rows, size_t cols, sf::Vector2f origin, float cellSize, float cellGap, sf::Color color);
+	bool setColor(size_t cell, sf::Color color);
+	void setColors(const std::vector<uint8_t>& states, sf::Color clearColor, sf::Color setColor);
+	sf::Color getColor(size_t cell) const;
+	sf::FloatRect getCellBounds(size_t cell) const;
+	void draw(sf::RenderTarget& target, const sf::FloatRect& region, const sf::RenderStates& states = sf::RenderStates::Default);
+	size_t getChunkCount() const;
+private:
+	struct Chunk {
+		std::vector<sf::Vertex> vertices;
+		sf::FloatRect bounds;
+		sf::VertexBuffer buffer{ sf::Quads, sf::VertexBuffer::Stream };
+		bool dirty{ true };
+	};
+	size_t m_rows{ 0 }, m_cols{ 0 };
+	size_t m_chunkCols{ 0 };
+	std::vector<Chunk> m_chunks;
+	bool m_useBuffers{ false };
+	sf::Vector2f m_origin;
+	float m_cellSize{ 0 };
+	size_t locate(size_t cell, size_t& chunkIndex) const;
+};
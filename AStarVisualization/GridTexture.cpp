@@ -0,0 +1,163 @@
+#include "GridTexture.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Rebuild the levels for a new grid, every cell gets the same color
+// Cell (i, j) covers the square of side cellSize at origin + (j, i) * cellSize, its cell id is j + cols * i.
+void GridTexture::reset(size_t rows, size_t cols, sf::Vector2f origin, float cellSize, sf::Color color) {
+	m_rows = rows;
+	m_cols = cols;
+	m_origin = origin;
+	m_cellSize = cellSize;
+	m_levels.clear();
+	size_t levelRows = rows, levelCols = cols;
+	while (true) {
+		auto& level = m_levels.emplace_back();
+		level.rows = levelRows;
+		level.cols = levelCols;
+		level.pixels.resize(levelRows * levelCols * 4);
+		for (size_t i = 0; i < level.pixels.size(); i += 4) {
+			level.pixels[i] = color.r;
+			level.pixels[i + 1] = color.g;
+			level.pixels[i + 2] = color.b;
+			level.pixels[i + 3] = color.a;
+		}
+		level.uploadEnd = levelRows;
+		if (levelRows == 1 && levelCols == 1)
+			break;
+		levelRows = (levelRows + 1) / 2;
+		levelCols = (levelCols + 1) / 2;
+	}
+}
+
+void GridTexture::markRows(size_t& begin, size_t& end, size_t rowBegin, size_t rowEnd) {
+	if (begin == end) {
+		begin = rowBegin;
+		end = rowEnd;
+	}
+	else {
+		begin = std::min(begin, rowBegin);
+		end = std::max(end, rowEnd);
+	}
+}
+
+// Returns true if the color of the cell changed
+bool GridTexture::setColor(size_t cell, sf::Color color) {
+	auto texel = &m_levels[0].pixels[cell * 4];
+	if (texel[0] == color.r && texel[1] == color.g && texel[2] == color.b && texel[3] == color.a)
+		return false;
+	texel[0] = color.r;
+	texel[1] = color.g;
+	texel[2] = color.b;
+	texel[3] = color.a;
+	size_t row = cell / m_cols;
+	markRows(m_levels[0].uploadBegin, m_levels[0].uploadEnd, row, row + 1);
+	for (size_t k = 1; k < m_levels.size(); ++k) {
+		size_t levelRow = row >> k;
+		markRows(m_levels[k].staleBegin, m_levels[k].staleEnd, levelRow, levelRow + 1);
+	}
+	return true;
+}
+
+// Color every cell in one pass, setColor where states is not 0 and clearColor elsewhere
+void GridTexture::setColors(const std::vector<uint8_t>& states, sf::Color clearColor, sf::Color setColor) {
+	auto& pixels = m_levels[0].pixels;
+	for (size_t cell = 0; cell < m_rows * m_cols; ++cell) {
+		sf::Color color = states[cell] ? setColor : clearColor;
+		pixels[cell * 4] = color.r;
+		pixels[cell * 4 + 1] = color.g;
+		pixels[cell * 4 + 2] = color.b;
+		pixels[cell * 4 + 3] = color.a;
+	}
+	markRows(m_levels[0].uploadBegin, m_levels[0].uploadEnd, 0, m_rows);
+	for (size_t k = 1; k < m_levels.size(); ++k)
+		markRows(m_levels[k].staleBegin, m_levels[k].staleEnd, 0, m_levels[k].rows);
+}
+
+sf::Color GridTexture::getColor(size_t cell) const {
+	auto texel = &m_levels[0].pixels[cell * 4];
+	return sf::Color(texel[0], texel[1], texel[2], texel[3]);
+}
+
+// The coarsest level that still has a texel per screen pixel, and that fits into a texture
+size_t GridTexture::selectLevel(float pixelsPerCell) const {
+	size_t level = 0;
+	if (pixelsPerCell > 0 && pixelsPerCell < 1)
+		level = static_cast<size_t>(std::floor(std::log2(1.f / pixelsPerCell)));
+	level = std::min(level, m_levels.size() - 1);
+	unsigned maxSize = sf::Texture::getMaximumSize();
+	while (level + 1 < m_levels.size() && (m_levels[level].rows > maxSize || m_levels[level].cols > maxSize))
+		++level;
+	return level;
+}
+
+// Recompute the stale rows of the level by averaging 2 x 2 texels of the level below
+void GridTexture::downsample(size_t level) {
+	auto& dst = m_levels[level];
+	auto& src = m_levels[level - 1];
+	for (size_t i = dst.staleBegin; i < dst.staleEnd; ++i) {
+		size_t srcRow0 = 2 * i, srcRow1 = std::min(2 * i + 1, src.rows - 1);
+		for (size_t j = 0; j < dst.cols; ++j) {
+			size_t srcCol0 = 2 * j, srcCol1 = std::min(2 * j + 1, src.cols - 1);
+			const sf::Uint8* texels[4] = {
+				&src.pixels[(srcCol0 + src.cols * srcRow0) * 4], &src.pixels[(srcCol1 + src.cols * srcRow0) * 4],
+				&src.pixels[(srcCol0 + src.cols * srcRow1) * 4], &src.pixels[(srcCol1 + src.cols * srcRow1) * 4]
+			};
+			auto texel = &dst.pixels[(j + dst.cols * i) * 4];
+			for (size_t channel = 0; channel < 4; ++channel) {
+				unsigned sum = texels[0][channel] + texels[1][channel] + texels[2][channel] + texels[3][channel];
+				texel[channel] = static_cast<sf::Uint8>((sum + 2) / 4);
+			}
+		}
+	}
+	markRows(dst.uploadBegin, dst.uploadEnd, dst.staleBegin, dst.staleEnd);
+	dst.staleBegin = dst.staleEnd = 0;
+}
+
+// Upload the dirty rows of the level, the whole level when its texture is created
+void GridTexture::upload(size_t level) {
+	auto& current = m_levels[level];
+	if (!current.created) {
+		current.created = current.texture.create(static_cast<unsigned>(current.cols), static_cast<unsigned>(current.rows));
+		current.uploadBegin = 0;
+		current.uploadEnd = current.rows;
+	}
+	if (current.created && current.uploadBegin != current.uploadEnd) {
+		current.texture.update(&current.pixels[current.uploadBegin * current.cols * 4],
+			static_cast<unsigned>(current.cols), static_cast<unsigned>(current.uploadEnd - current.uploadBegin),
+			0, static_cast<unsigned>(current.uploadBegin));
+	}
+	current.uploadBegin = current.uploadEnd = 0;
+}
+
+// pixelsPerCell is the on-screen size of a cell, it selects the level
+void GridTexture::draw(sf::RenderTarget& target, float pixelsPerCell, const sf::RenderStates& states) {
+	if (m_levels.empty())
+		return;
+	size_t level = selectLevel(pixelsPerCell);
+	for (size_t k = 1; k <= level; ++k) {
+		if (m_levels[k].staleBegin != m_levels[k].staleEnd)
+			downsample(k);
+	}
+	upload(level);
+	auto& current = m_levels[level];
+	if (!current.created)
+		return;
+	// A texel of level k covers 2^k cells, the last texels may cover fewer
+	float scale = 1.f / static_cast<float>(size_t(1) << level);
+	float width = m_cols * m_cellSize, height = m_rows * m_cellSize;
+	float texWidth = m_cols * scale, texHeight = m_rows * scale;
+	sf::Vertex quad[4] = {
+		sf::Vertex(m_origin, sf::Vector2f(0, 0)),
+		sf::Vertex(sf::Vector2f(m_origin.x + width, m_origin.y), sf::Vector2f(texWidth, 0)),
+		sf::Vertex(sf::Vector2f(m_origin.x + width, m_origin.y + height), sf::Vector2f(texWidth, texHeight)),
+		sf::Vertex(sf::Vector2f(m_origin.x, m_origin.y + height), sf::Vector2f(0, texHeight))
+	};
+	sf::RenderStates textured(states);
+	textured.texture = &current.texture;
+	target.draw(quad, 4, sf::Quads, textured);
+}
+
+size_t GridTexture::getLevelCount() const {
+	return m_levels.size();
+}
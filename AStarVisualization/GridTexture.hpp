@@ -0,0 +1,39 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+// Draws a rows x cols grid as one textured quad with one texel per cell
+// Level 0 holds the cell colors and level k averages blocks of 2^k x 2^k cells, like the mip levels of a texture.
+// setColor writes level 0 and marks the changed row dirty in every level. draw picks the level that matches
+// the on-screen cell size, brings only the dirty rows of the levels up to it up to date and uploads them,
+// so a zoomed out view of a huge grid touches a small texture and no per-cell geometry.
+class GridTexture
+{
+public:
+	void reset(size_t rows, size_t cols, sf::Vector2f origin, float cellSize, sf::Color color);
+	bool setColor(size_t cell, sf::Color color);
+	void setColors(const std::vector<uint8_t>& states, sf::Color clearColor, sf::Color setColor);
+	sf::Color getColor(size_t cell) const;
+	void draw(sf::RenderTarget& target, float pixelsPerCell, const sf::RenderStates& states = sf::RenderStates::Default);
+	size_t getLevelCount() const;
+private:
+	struct Level {
+		size_t rows{ 0 }, cols{ 0 };
+		// RGBA texels
+		std::vector<sf::Uint8> pixels;
+		sf::Texture texture;
+		bool created{ false };
+		// Rows whose texels are older than the level below, always empty for level 0
+		size_t staleBegin{ 0 }, staleEnd{ 0 };
+		// Rows whose texels are not uploaded yet
+		size_t uploadBegin{ 0 }, uploadEnd{ 0 };
+	};
+	std::vector<Level> m_levels;
+	size_t m_rows{ 0 }, m_cols{ 0 };
+	sf::Vector2f m_origin;
+	float m_cellSize{ 0 };
+	static void markRows(size_t& begin, size_t& end, size_t rowBegin, size_t rowEnd);
+	size_t selectLevel(float pixelsPerCell) const;
+	void downsample(size_t level);
+	void upload(size_t level);
+};
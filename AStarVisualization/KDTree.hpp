@@ -1,183 +1,617 @@
 #pragma once
 #include <array>
 #include <vector>
-#include <memory>
+#include <span>
+#include <numeric>
+#include <queue>
+#include <limits>
+#include <cstdint>
+#include <type_traits>
 #include <algorithm>
 #include <stdexcept>
+#include "ThreadPool.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KDTREE_USE_SSE 1
+#else
+#define KDTREE_USE_SSE 0
+#endif
 
+// Static k-d tree stored in a flat array
+// The pairs are permuted in place so that every subtree is a contiguous range [from, to).
+// The median (from + to) / 2 of a range on the axis depth % K is the node of the range,
+// points on its left are <= the median value and points on its right are >= the median value.
+// Ranges that hold at most LeafSize points are leaf buckets and are scanned linearly.
+// Erased pairs are tombstoned and removed by a rebuild once they make up half of the tree.
+// The tree is meant to be built in bulk, DynamicKDTree keeps a forest of them for continuous insertions.
 template <size_t K, class Data, class T = float>
 class KDTree
 {
-private:
+public:
 	using Point = typename std::array<T, K>;
 	using PointDataPair = typename std::pair<Point, Data>;
-	struct Node {
-		Point point;
-		Data data;
-		std::shared_ptr<Node> left;
-		std::shared_ptr<Node> right;
-		Node(const Point& point_, const Data& data_) : point(point_), data(data_) {}
-		Node(const PointDataPair& pair) : point(pair.first), data(pair.second) {}
-	};
-	std::shared_ptr<Node> m_root;
+	static constexpr size_t LeafSize = 8;
+	// Ranges smaller than this are always partitioned and built by a single thread
+	static constexpr size_t ParallelGrain = size_t(1) << 15;
+
+private:
+	// Pairs in tree order
+	std::vector<PointDataPair> m_pairs;
+	// Structure of arrays copy of the points in m_pairs for the leaf scans
+	// The coordinates of erased points are set to infinity
+	std::array<std::vector<T>, K> m_coords;
+	// Inserted pairs that are not merged into the tree yet
+	std::vector<PointDataPair> m_pending;
+	// 0 if the pair at the same index in m_pairs is erased
+	std::vector<uint8_t> m_alive;
+	size_t m_numErased{ 0 };
+	// Bounding box of the points in m_pairs
+	Point m_lower{};
+	Point m_upper{};
 public:
 	KDTree() = default;
-	KDTree(std::vector<PointDataPair>& pairs) { m_root = buildTree(pairs, 0, 0, pairs.size()); }
+	KDTree(const std::vector<PointDataPair>& pairs) { buildTree(pairs); }
 	void insert(const PointDataPair& pair);
-	PointDataPair findNearestNeighbor(const Point& target);
-	std::vector<PointDataPair> searchRange(const Point& lowerBound, const Point& upperBound);
-	void buildTree(std::vector<PointDataPair>& pairs);
+	bool erase(const Point& point, const Data& data);
+	PointDataPair findNearestNeighbor(const Point& target) const;
+	bool findNearestNeighbor(const Point& target, PointDataPair& result, T& bestSquaredDist) const;
+	void findNearestNeighbors(std::span<const Point> targets, std::span<PointDataPair> results) const;
+	std::vector<PointDataPair> kNearest(const Point& target, size_t k) const;
+	std::vector<PointDataPair> searchRange(const Point& lowerBound, const Point& upperBound) const;
+	std::vector<PointDataPair> searchRadius(const Point& center, T radius) const;
+	template <class Visitor> void visitRange(const Point& lowerBound, const Point& upperBound, Visitor&& visitor) const;
+	template <class Visitor> void visitRadius(const Point& center, T radius, Visitor&& visitor) const;
+	void buildTree(const std::vector<PointDataPair>& pairs);
+	void buildTree(const std::vector<PointDataPair>& pairs, ThreadPool& pool);
+	std::vector<PointDataPair> getPairs() const;
 	void clear();
+	size_t size() const;
+	bool empty() const;
 
 private:
-	std::shared_ptr<Node> buildTree(std::vector<PointDataPair>& pairs, size_t depth, size_t from, size_t to);
-	PointDataPair findNearestNeighbor(std::shared_ptr<Node> node, const Point& target, size_t depth);
-	T getSquaredDistance(const Point& p1, const Point& p2);
-	void searchRange(std::shared_ptr<Node> node, const Point& lowerBound, const Point& upperBound,
-		size_t depth, std::vector<PointDataPair>& results);
+	void buildTree(size_t depth, size_t from, size_t to);
+	void buildTree(size_t depth, size_t from, size_t to, ThreadPool& pool);
+	void selectMedian(size_t axis, size_t from, size_t nthIndex, size_t to, ThreadPool& pool, std::vector<PointDataPair>& scratch);
+	void buildCoords(ThreadPool* pool = nullptr);
+	void rebuild();
+	size_t find(const Point& point, const Data& data, size_t depth, size_t from, size_t to) const;
+	void findNearestNeighbor(const Point& target, size_t depth, size_t from, size_t to, size_t& best, T& bestDist) const;
+	void scanLeaf(const Point& target, size_t from, size_t to, size_t& best, T& bestDist) const;
+	void scanPending(const Point& target, size_t& best, T& bestDist) const;
+	const PointDataPair& getPair(size_t index) const;
+	uint64_t getMortonKey(const Point& point) const;
+	static T getSquaredDistance(const Point& p1, const Point& p2);
+	static bool isInRange(const Point& point, const Point& lowerBound, const Point& upperBound);
+	using DistIndexHeap = std::priority_queue<std::pair<T, size_t>>;
+	void kNearest(const Point& target, size_t k, size_t depth, size_t from, size_t to, DistIndexHeap& heap) const;
+	static void pushBounded(DistIndexHeap& heap, size_t k, T distance, size_t index);
+	template <class Visitor> void visitRange(const Point& lowerBound, const Point& upperBound,
+		size_t depth, size_t from, size_t to, Visitor& visitor) const;
+	template <class Visitor> void visitRadius(const Point& center, T squaredRadius,
+		size_t depth, size_t from, size_t to, Visitor& visitor) const;
 };
 
 // Insert a point data pair into the tree
-// This method does not guarantee the resulting tree will be balanced
+// The pair is buffered and the tree is rebuilt once the buffer outgrows a fraction of the tree,
+// so the tree stays balanced with an amortized O(log N) insertion cost.
+// Queries scan the buffer linearly, up to N / 8 pairs, use DynamicKDTree for many insertions between queries
 template <size_t K, class Data, class T>
 void KDTree<K, Data, T>::insert(const PointDataPair& pair) {
-	if (!m_root) {
-		m_root.reset(new Node(pair));
-	}
-	else {
-		const auto& point = pair.first;
-		size_t curDepth = 0;
-		std::shared_ptr<Node> curNode = m_root;
-		std::shared_ptr<Node> nextNode = m_root;
-		while (true) {
-			const T& curValue = curNode->point[curDepth];
-			if (curValue < point[curDepth]) {
-				nextNode = curNode->right;
-				if (!nextNode) {
-					curNode->right.reset(new Node(pair));
-					break;
-				}
-			}
-			else {
-				nextNode = curNode->left;
-				if (!nextNode) {
-					curNode->left.reset(new Node(pair));
-					break;
-				}
-			}
-			curNode = nextNode;
-			curDepth = (curDepth + 1) % K;
+	m_pending.push_back(pair);
+	if (m_pending.size() > LeafSize + m_pairs.size() / 8)
+		rebuild();
+}
+
+// Erase a point data pair from the tree
+// Returns false if the pair is not in the tree
+template <size_t K, class Data, class T>
+bool KDTree<K, Data, T>::erase(const Point& point, const Data& data) {
+	for (size_t i = 0; i < m_pending.size(); ++i) {
+		if (m_pending[i].first == point && m_pending[i].second == data) {
+			m_pending[i] = std::move(m_pending.back());
+			m_pending.pop_back();
+			return true;
 		}
 	}
+	size_t index = find(point, data, 0, 0, m_pairs.size());
+	if (index == std::numeric_limits<size_t>::max())
+		return false;
+	// Tombstone the pair, an infinite distance keeps it out of the leaf scans
+	m_alive[index] = 0;
+	if constexpr (std::numeric_limits<T>::has_infinity) {
+		for (auto& coords : m_coords)
+			coords[index] = std::numeric_limits<T>::infinity();
+	}
+	++m_numErased;
+	if (m_numErased * 2 > m_pairs.size())
+		rebuild();
+	return true;
 }
 
 // Find a nearest point data pair to the given point in the tree
 template <size_t K, class Data, class T>
-typename KDTree<K, Data, T>::PointDataPair KDTree<K, Data, T>::findNearestNeighbor(const Point& target) {
-	if (!m_root)
+typename KDTree<K, Data, T>::PointDataPair KDTree<K, Data, T>::findNearestNeighbor(const Point& target) const {
+	if (empty())
+		throw std::runtime_error("Tree is empty");
+	size_t best = std::numeric_limits<size_t>::max();
+	T bestDist = std::numeric_limits<T>::max();
+	findNearestNeighbor(target, 0, 0, m_pairs.size(), best, bestDist);
+	scanPending(target, best, bestDist);
+	return getPair(best);
+}
+
+// Replace 'result' with the nearest pair if it is closer than 'bestSquaredDist'
+// Returns true if 'result' has been replaced
+template <size_t K, class Data, class T>
+bool KDTree<K, Data, T>::findNearestNeighbor(const Point& target, PointDataPair& result, T& bestSquaredDist) const {
+	size_t best = std::numeric_limits<size_t>::max();
+	findNearestNeighbor(target, 0, 0, m_pairs.size(), best, bestSquaredDist);
+	scanPending(target, best, bestSquaredDist);
+	if (best == std::numeric_limits<size_t>::max())
+		return false;
+	result = getPair(best);
+	return true;
+}
+
+// Find the nearest point data pair of every target point
+// results[i] receives the nearest pair of targets[i]
+// Queries are processed in Morton order, and each query starts from the answer of the previous one,
+// so nearby queries prune most of the tree right away
+template <size_t K, class Data, class T>
+void KDTree<K, Data, T>::findNearestNeighbors(std::span<const Point> targets, std::span<PointDataPair> results) const {
+	if (targets.size() != results.size())
+		throw std::invalid_argument("targets and results have different sizes");
+	if (targets.empty())
+		return;
+	if (empty())
 		throw std::runtime_error("Tree is empty");
-	return findNearestNeighbor(m_root, target, 0);
+
+	// Sort the queries along a Z-order curve for traversal coherence
+	std::vector<std::pair<uint64_t, size_t>> order(targets.size());
+	for (size_t i = 0; i < targets.size(); ++i)
+		order[i] = { getMortonKey(targets[i]), i };
+	std::sort(order.begin(), order.end());
+
+	size_t best = std::numeric_limits<size_t>::max();
+	for (auto& [key, queryIndex] : order) {
+		const Point& target = targets[queryIndex];
+		T bestDist = std::numeric_limits<T>::max();
+		// Seed the search with the previous answer
+		if (best != std::numeric_limits<size_t>::max())
+			bestDist = getSquaredDistance(target, getPair(best).first);
+		findNearestNeighbor(target, 0, 0, m_pairs.size(), best, bestDist);
+		scanPending(target, best, bestDist);
+		results[queryIndex] = getPair(best);
+	}
+}
+
+// Find the k nearest point data pairs to the given point, closest first
+// A bounded max-heap keeps the k best candidates, its top is the pruning distance
+template <size_t K, class Data, class T>
+std::vector<typename KDTree<K, Data, T>::PointDataPair> KDTree<K, Data, T>::kNearest(const Point& target, size_t k) const {
+	std::vector<PointDataPair> results;
+	if (k == 0 || empty())
+		return results;
+	std::vector<std::pair<T, size_t>> storage;
+	storage.reserve(k + 1);
+	DistIndexHeap heap(std::less<std::pair<T, size_t>>(), std::move(storage));
+	kNearest(target, k, 0, 0, m_pairs.size(), heap);
+	size_t offset = m_pairs.size();
+	for (size_t i = 0; i < m_pending.size(); ++i)
+		pushBounded(heap, k, getSquaredDistance(target, m_pending[i].first), offset + i);
+
+	results.resize(heap.size());
+	for (size_t i = heap.size(); i > 0; --i) {
+		results[i - 1] = getPair(heap.top().second);
+		heap.pop();
+	}
+	return results;
 }
 
 // Find point data pairs in the given range
 template <size_t K, class Data, class T>
 std::vector<typename KDTree<K, Data, T>::PointDataPair> KDTree<K, Data, T>::searchRange(
-	const Point& lowerBound, const Point& upperBound) {
+	const Point& lowerBound, const Point& upperBound) const {
+
+	std::vector<PointDataPair> results;
+	visitRange(lowerBound, upperBound, [&results](const Point& point, const Data& data) {
+		results.push_back({ point, data });
+		});
+	return results;
+}
+
+// Find point data pairs within the given distance of the center
+template <size_t K, class Data, class T>
+std::vector<typename KDTree<K, Data, T>::PointDataPair> KDTree<K, Data, T>::searchRadius(
+	const Point& center, T radius) const {
 
 	std::vector<PointDataPair> results;
-	searchRange(m_root, lowerBound, upperBound, 0, results);
+	visitRadius(center, radius, [&results](const Point& point, const Data& data) {
+		results.push_back({ point, data });
+		});
 	return results;
 }
 
+// Call visitor(point, data) for every pair in the given range without allocating
+template <size_t K, class Data, class T>
+template <class Visitor>
+void KDTree<K, Data, T>::visitRange(const Point& lowerBound, const Point& upperBound, Visitor&& visitor) const {
+	visitRange(lowerBound, upperBound, 0, 0, m_pairs.size(), visitor);
+	for (auto& [point, data] : m_pending) {
+		if (isInRange(point, lowerBound, upperBound))
+			visitor(point, data);
+	}
+}
+
+// Call visitor(point, data) for every pair within the given distance of the center without allocating
+template <size_t K, class Data, class T>
+template <class Visitor>
+void KDTree<K, Data, T>::visitRadius(const Point& center, T radius, Visitor&& visitor) const {
+	T squaredRadius = radius * radius;
+	visitRadius(center, squaredRadius, 0, 0, m_pairs.size(), visitor);
+	for (auto& [point, data] : m_pending) {
+		if (getSquaredDistance(center, point) <= squaredRadius)
+			visitor(point, data);
+	}
+}
+
 // Clear the tree and Rebuild the tree using the given point data pairs
 template <size_t K, class Data, class T>
-void KDTree<K, Data, T>::buildTree(std::vector<PointDataPair>& pairs) {
+void KDTree<K, Data, T>::buildTree(const std::vector<PointDataPair>& pairs) {
 	clear();
-	m_root = buildTree(pairs, 0, 0, pairs.size());
+	m_pairs = pairs;
+	buildTree(0, 0, m_pairs.size());
+	buildCoords();
+}
+
+// Clear the tree and Rebuild the tree using the given point data pairs with the threads of 'pool'
+// ThreadPool::getShared() uses every hardware thread. The tree is as balanced as the single threaded build,
+// but points that are equal on a splitting axis may end up in a different order.
+template <size_t K, class Data, class T>
+void KDTree<K, Data, T>::buildTree(const std::vector<PointDataPair>& pairs, ThreadPool& pool) {
+	clear();
+	m_pairs = pairs;
+	buildTree(0, 0, m_pairs.size(), pool);
+	buildCoords(&pool);
+}
+
+// Get a copy of every pair in the tree that is not erased
+template <size_t K, class Data, class T>
+std::vector<typename KDTree<K, Data, T>::PointDataPair> KDTree<K, Data, T>::getPairs() const {
+	std::vector<PointDataPair> pairs;
+	pairs.reserve(size());
+	for (size_t i = 0; i < m_pairs.size(); ++i) {
+		if (m_alive[i])
+			pairs.push_back(m_pairs[i]);
+	}
+	pairs.insert(pairs.end(), m_pending.begin(), m_pending.end());
+	return pairs;
 }
 
 // Clear the tree
 template <size_t K, class Data, class T>
 void KDTree<K, Data, T>::clear() {
-	m_root.reset();
+	m_pairs.clear();
+	m_pending.clear();
+	m_alive.clear();
+	m_numErased = 0;
+	for (auto& coords : m_coords)
+		coords.clear();
+}
+
+template <size_t K, class Data, class T>
+size_t KDTree<K, Data, T>::size() const {
+	return m_pairs.size() - m_numErased + m_pending.size();
 }
 
-// Build a balanced k-d tree from the point data pair vector
 template <size_t K, class Data, class T>
-std::shared_ptr<typename KDTree<K, Data, T>::Node> KDTree<K, Data, T>::buildTree(std::vector<PointDataPair>& pairs, size_t depth, size_t from, size_t to) {
+bool KDTree<K, Data, T>::empty() const {
+	return size() == 0;
+}
+
+// Build a balanced k-d tree in the range [from, to) of m_pairs
+template <size_t K, class Data, class T>
+void KDTree<K, Data, T>::buildTree(size_t depth, size_t from, size_t to) {
+	if (to - from <= LeafSize)
+		return;
 	size_t kIndex = depth % K;
 	size_t nthIndex = (from + to) / 2;
-	auto nth = nthIndex + pairs.begin();
 	// Find the median point at depth 'kIndex'
-	std::nth_element(pairs.begin() + from, nth, pairs.begin() + to,
+	std::nth_element(m_pairs.begin() + from, m_pairs.begin() + nthIndex, m_pairs.begin() + to,
 		[kIndex](const PointDataPair& a, const PointDataPair& b) {
 			return a.first[kIndex] < b.first[kIndex];
 		});
-	auto curNode = std::make_shared<Node>(*nth);
 	// Extend children
-	if (nthIndex - from > 0)
-		curNode->left = buildTree(pairs, depth + 1, from, nthIndex);
-	if (to - nthIndex > 1)
-		curNode->right = buildTree(pairs, depth + 1, nthIndex + 1, to);
-	return curNode;
+	buildTree(depth + 1, from, nthIndex);
+	buildTree(depth + 1, nthIndex + 1, to);
+}
+
+// Build a balanced k-d tree in the range [from, to) of m_pairs with one task per thread of 'pool'
+// The medians of the top levels are selected by a parallel partition of their ranges, one level at a time,
+// until there is a range per task. The ranges touch disjoint parts of m_pairs and are built concurrently.
+template <size_t K, class Data, class T>
+void KDTree<K, Data, T>::buildTree(size_t depth, size_t from, size_t to, ThreadPool& pool) {
+	size_t numThreads = pool.getNumThreads();
+	std::vector<PointDataPair> scratch;
+	std::vector<std::pair<size_t, size_t>> ranges{ { from, to } };
+	// The ranges of a level differ in size by at most one
+	for (; ranges.size() < numThreads && ranges.front().second - ranges.front().first > ParallelGrain; ++depth) {
+		std::vector<std::pair<size_t, size_t>> children;
+		children.reserve(ranges.size() * 2);
+		for (auto [rangeFrom, rangeTo] : ranges) {
+			size_t nthIndex = (rangeFrom + rangeTo) / 2;
+			selectMedian(depth % K, rangeFrom, nthIndex, rangeTo, pool, scratch);
+			children.push_back({ rangeFrom, nthIndex });
+			children.push_back({ nthIndex + 1, rangeTo });
+		}
+		ranges = std::move(children);
+	}
+	pool.parallelFor(ranges.size(), [this, depth, &ranges](size_t i) {
+		buildTree(depth, ranges[i].first, ranges[i].second);
+		});
+}
+
+// Move the median on 'axis' of the range [from, to) of m_pairs to nthIndex, like std::nth_element
+// Each round splits the range into pairs below, equal to and above a sampled pivot with a task per thread of 'pool'
+// and keeps the part holding nthIndex, small parts are finished by std::nth_element
+template <size_t K, class Data, class T>
+void KDTree<K, Data, T>::selectMedian(size_t axis, size_t from, size_t nthIndex, size_t to, ThreadPool& pool,
+	std::vector<PointDataPair>& scratch) {
+
+	size_t numThreads = pool.getNumThreads();
+	while (to - from > ParallelGrain) {
+		// The pivot is the median of evenly spaced samples
+		std::array<T, 63> samples;
+		size_t step = (to - from) / samples.size();
+		for (size_t i = 0; i < samples.size(); ++i)
+			samples[i] = m_pairs[from + i * step].first[axis];
+		std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+		T pivot = samples[samples.size() / 2];
+		auto getSide = [axis, pivot](const PointDataPair& pair) -> size_t {
+			return pair.first[axis] < pivot ? 0 : (pivot < pair.first[axis] ? 2 : 1);
+		};
+
+		// Count the sides in contiguous chunks, then give every chunk its place in each side
+		auto chunkBegin = [from, to, numThreads](size_t chunk) { return from + (to - from) * chunk / numThreads; };
+		std::vector<std::array<size_t, 3>> offsets(numThreads);
+		pool.parallelFor(numThreads, [&](size_t chunk) {
+			std::array<size_t, 3> counts{};
+			for (size_t i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i)
+				++counts[getSide(m_pairs[i])];
+			offsets[chunk] = counts;
+			});
+		std::array<size_t, 3> totals{};
+		for (auto& counts : offsets) {
+			for (size_t side = 0; side < 3; ++side)
+				totals[side] += counts[side];
+		}
+		std::array<size_t, 3> next{ 0, totals[0], totals[0] + totals[1] };
+		for (auto& counts : offsets) {
+			auto chunkCounts = counts;
+			counts = next;
+			for (size_t side = 0; side < 3; ++side)
+				next[side] += chunkCounts[side];
+		}
+
+		scratch.resize(std::max(scratch.size(), to - from));
+		pool.parallelFor(numThreads, [&](size_t chunk) {
+			auto place = offsets[chunk];
+			for (size_t i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i)
+				scratch[place[getSide(m_pairs[i])]++] = std::move(m_pairs[i]);
+			});
+		pool.parallelFor(numThreads, [&](size_t chunk) {
+			for (size_t i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i)
+				m_pairs[i] = std::move(scratch[i - from]);
+			});
+
+		size_t equalBegin = from + totals[0], equalEnd = equalBegin + totals[1];
+		if (nthIndex < equalBegin)
+			to = equalBegin;
+		else if (nthIndex >= equalEnd)
+			from = equalEnd;
+		else
+			return;
+	}
+	std::nth_element(m_pairs.begin() + from, m_pairs.begin() + nthIndex, m_pairs.begin() + to,
+		[axis](const PointDataPair& a, const PointDataPair& b) {
+			return a.first[axis] < b.first[axis];
+		});
+}
+
+// Copy the points into m_coords and compute the bounding box
+// Large trees are split into one contiguous chunk per thread of 'pool', without a pool the copy is serial
+template <size_t K, class Data, class T>
+void KDTree<K, Data, T>::buildCoords(ThreadPool* pool) {
+	size_t size = m_pairs.size();
+	for (auto& coords : m_coords)
+		coords.resize(size);
+	size_t numThreads = pool ? std::clamp<size_t>(size / ParallelGrain, 1, pool->getNumThreads()) : 1;
+	std::vector<Point> lowers(numThreads), uppers(numThreads);
+	auto copyChunk = [this, size, numThreads, &lowers, &uppers](size_t chunk) {
+		size_t from = size * chunk / numThreads, to = size * (chunk + 1) / numThreads;
+		for (size_t i = 0; i < K; ++i) {
+			auto& coords = m_coords[i];
+			T lower = std::numeric_limits<T>::max();
+			T upper = std::numeric_limits<T>::lowest();
+			for (size_t j = from; j < to; ++j) {
+				const T& value = m_pairs[j].first[i];
+				coords[j] = value;
+				lower = std::min(lower, value);
+				upper = std::max(upper, value);
+			}
+			lowers[chunk][i] = lower;
+			uppers[chunk][i] = upper;
+		}
+	};
+	if (pool)
+		pool->parallelFor(numThreads, copyChunk);
+	else
+		copyChunk(0);
+
+	m_lower = lowers[0];
+	m_upper = uppers[0];
+	for (size_t chunk = 1; chunk < numThreads; ++chunk) {
+		for (size_t i = 0; i < K; ++i) {
+			m_lower[i] = std::min(m_lower[i], lowers[chunk][i]);
+			m_upper[i] = std::max(m_upper[i], uppers[chunk][i]);
+		}
+	}
+	m_alive.assign(size, 1);
+	m_numErased = 0;
+}
+
+// Drop the erased pairs, merge the pending pairs and rebuild the tree
+template <size_t K, class Data, class T>
+void KDTree<K, Data, T>::rebuild() {
+	size_t last = 0;
+	for (size_t i = 0; i < m_pairs.size(); ++i) {
+		if (m_alive[i])
+			m_pairs[last++] = std::move(m_pairs[i]);
+	}
+	m_pairs.resize(last);
+	m_pairs.insert(m_pairs.end(), m_pending.begin(), m_pending.end());
+	m_pending.clear();
+	buildTree(0, 0, m_pairs.size());
+	buildCoords();
+}
+
+// Find the index of a pair in the range [from, to) of m_pairs
+// Both branches are searched when the point lies on the splitting plane
+template <size_t K, class Data, class T>
+size_t KDTree<K, Data, T>::find(const Point& point, const Data& data, size_t depth, size_t from, size_t to) const {
+	constexpr size_t notFound = std::numeric_limits<size_t>::max();
+	if (to - from <= LeafSize) {
+		for (size_t i = from; i < to; ++i) {
+			if (m_alive[i] && m_pairs[i].first == point && m_pairs[i].second == data)
+				return i;
+		}
+		return notFound;
+	}
+	size_t curDepth = depth % K;
+	size_t nthIndex = (from + to) / 2;
+	const T& curValue = m_pairs[nthIndex].first[curDepth];
+	if (m_alive[nthIndex] && m_pairs[nthIndex].first == point && m_pairs[nthIndex].second == data)
+		return nthIndex;
+	if (point[curDepth] <= curValue) {
+		size_t index = find(point, data, depth + 1, from, nthIndex);
+		if (index != notFound)
+			return index;
+	}
+	if (point[curDepth] >= curValue)
+		return find(point, data, depth + 1, nthIndex + 1, to);
+	return notFound;
 }
 
 // private findNearestNeighbor helper
+// Updates 'best' and 'bestDist' if a closer point is found in the range [from, to)
 template <size_t K, class Data, class T>
-typename KDTree<K, Data, T>::PointDataPair KDTree<K, Data, T>::findNearestNeighbor(
-	std::shared_ptr<Node> node, const Point& target, size_t depth) {
+void KDTree<K, Data, T>::findNearestNeighbor(const Point& target, size_t depth, size_t from, size_t to,
+	size_t& best, T& bestDist) const {
 
+	if (to - from <= LeafSize) {
+		scanLeaf(target, from, to, best, bestDist);
+		return;
+	}
 	size_t curDepth = depth % K;
-	std::shared_ptr<Node> nextBranch;
-	std::shared_ptr<Node> otherBranch;
-	// Determine the next and other branches 
-	// based on the point values at curDepth
-	if (target[curDepth] < node->point[curDepth]) {
-		nextBranch = node->left;
-		otherBranch = node->right;
-	}
-	else {
-		nextBranch = node->right;
-		otherBranch = node->left;
-	}
-	T bestDist;
-	PointDataPair bestPair;
-	PointDataPair tempPair;
-
-	// Explore the next branch if it is not null
-	if (nextBranch) {
-		// Compare 'node->point' and 'tempPoint' and choose the better point
-		tempPair = findNearestNeighbor(nextBranch, target, depth + 1);
-		T distToRoot = getSquaredDistance(target, node->point);
-		T distToTemp = getSquaredDistance(target, tempPair.first);
-		if (distToRoot > distToTemp) {
-			bestDist = distToTemp;
-			bestPair = tempPair;
+	size_t nthIndex = (from + to) / 2;
+	T diff = target[curDepth] - m_pairs[nthIndex].first[curDepth];
+	// Explore the branch that contains the target first,
+	// then explore the other branch only if it can contain a closer point
+	if (diff < 0)
+		findNearestNeighbor(target, depth + 1, from, nthIndex, best, bestDist);
+	else
+		findNearestNeighbor(target, depth + 1, nthIndex + 1, to, best, bestDist);
+	scanLeaf(target, nthIndex, nthIndex + 1, best, bestDist);
+	if (diff * diff < bestDist) {
+		if (diff < 0)
+			findNearestNeighbor(target, depth + 1, nthIndex + 1, to, best, bestDist);
+		else
+			findNearestNeighbor(target, depth + 1, from, nthIndex, best, bestDist);
+	}
+}
+
+// Compare the target against every point of a leaf bucket
+// Four points are evaluated at once with SSE when T is float
+template <size_t K, class Data, class T>
+void KDTree<K, Data, T>::scanLeaf(const Point& target, size_t from, size_t to, size_t& best, T& bestDist) const {
+	size_t i = from;
+#if KDTREE_USE_SSE
+	if constexpr (std::is_same_v<T, float>) {
+		__m128 targetLanes[K];
+		for (size_t k = 0; k < K; ++k)
+			targetLanes[k] = _mm_set1_ps(target[k]);
+		alignas(16) float dists[4];
+		for (; i + 4 <= to; i += 4) {
+			__m128 sum = _mm_setzero_ps();
+			for (size_t k = 0; k < K; ++k) {
+				__m128 diff = _mm_sub_ps(_mm_loadu_ps(m_coords[k].data() + i), targetLanes[k]);
+				sum = _mm_add_ps(sum, _mm_mul_ps(diff, diff));
+			}
+			// Skip the block if none of the four points is closer
+			if (_mm_movemask_ps(_mm_cmplt_ps(sum, _mm_set1_ps(bestDist))) == 0)
+				continue;
+			_mm_store_ps(dists, sum);
+			for (size_t j = 0; j < 4; ++j) {
+				if (dists[j] < bestDist) {
+					bestDist = dists[j];
+					best = i + j;
+				}
+			}
 		}
-		else {
-			bestDist = distToRoot;
-			bestPair = { node->point, node->data };
+	}
+#endif
+	for (; i < to; ++i) {
+		if (!m_alive[i])
+			continue;
+		T distance = 0;
+		for (size_t k = 0; k < K; ++k) {
+			T diff = m_coords[k][i] - target[k];
+			distance += diff * diff;
+		}
+		if (distance < bestDist) {
+			bestDist = distance;
+			best = i;
 		}
 	}
-	// Handle the case when 'nextBranch' is null
-	else {
-		bestPair = { node->point, node->data };
-		bestDist = getSquaredDistance(target, node->point);
-	}
-
-	// Explore 'otherbranch' if it is not null
-	if (otherBranch) {
-		T diff = target[curDepth] - node->point[curDepth];
-		T distToOtherBranch = diff * diff;
-		// Search 'otherBranch' if bestDist >= distToOtherBranc
-		if (bestDist >= distToOtherBranch) {
-			tempPair = findNearestNeighbor(otherBranch, target, depth + 1);
-			if (bestDist > getSquaredDistance(target, tempPair.first))
-				bestPair = tempPair;
+}
+
+// Compare the target against the pairs that are not merged into the tree yet
+template <size_t K, class Data, class T>
+void KDTree<K, Data, T>::scanPending(const Point& target, size_t& best, T& bestDist) const {
+	size_t offset = m_pairs.size();
+	size_t size = m_pending.size();
+	for (size_t i = 0; i < size; ++i) {
+		T distance = getSquaredDistance(target, m_pending[i].first);
+		if (distance < bestDist) {
+			bestDist = distance;
+			best = offset + i;
 		}
 	}
-	return bestPair;
+}
+
+// Indices past the end of m_pairs refer to m_pending
+template <size_t K, class Data, class T>
+const typename KDTree<K, Data, T>::PointDataPair& KDTree<K, Data, T>::getPair(size_t index) const {
+	if (index < m_pairs.size())
+		return m_pairs[index];
+	return m_pending[index - m_pairs.size()];
+}
+
+// Interleave the quantized coordinates of the point within the bounding box
+template <size_t K, class Data, class T>
+uint64_t KDTree<K, Data, T>::getMortonKey(const Point& point) const {
+	constexpr size_t bits = std::min<size_t>(16, 64 / K);
+	constexpr double maxCell = static_cast<double>((uint64_t(1) << bits) - 1);
+	uint64_t key = 0;
+	for (size_t k = 0; k < K; ++k) {
+		double extent = static_cast<double>(m_upper[k]) - static_cast<double>(m_lower[k]);
+		double ratio = extent > 0 ? (static_cast<double>(point[k]) - static_cast<double>(m_lower[k])) / extent : 0.0;
+		auto cell = static_cast<uint64_t>(std::clamp(ratio, 0.0, 1.0) * maxCell);
+		for (size_t b = 0; b < bits; ++b)
+			key |= ((cell >> b) & 1) << (b * K + k);
+	}
+	return key;
 }
 
 // Calculate the distance between two points
@@ -191,30 +625,99 @@ T KDTree<K, Data, T>::getSquaredDistance(const Point& p1, const Point& p2) {
 	return distance;
 }
 
-// private searchRange helper
 template <size_t K, class Data, class T>
-void KDTree<K, Data, T>::searchRange(std::shared_ptr<Node> node, const Point& lowerBound, const Point& upperBound,
-	size_t depth, std::vector<PointDataPair>& results) {
-	if (!node)
-		return;
-	// Check the current node
-	bool inRange{ true };
+bool KDTree<K, Data, T>::isInRange(const Point& point, const Point& lowerBound, const Point& upperBound) {
 	for (size_t i = 0; i < K; ++i) {
-		if (node->point[i] < lowerBound[i] || node->point[i] > upperBound[i]) {
-			inRange = false;
-			break;
+		if (point[i] < lowerBound[i] || point[i] > upperBound[i])
+			return false;
+	}
+	return true;
+}
+
+// private kNearest helper
+template <size_t K, class Data, class T>
+void KDTree<K, Data, T>::kNearest(const Point& target, size_t k, size_t depth, size_t from, size_t to, DistIndexHeap& heap) const {
+	if (to - from <= LeafSize) {
+		for (size_t i = from; i < to; ++i) {
+			if (m_alive[i])
+				pushBounded(heap, k, getSquaredDistance(target, m_pairs[i].first), i);
 		}
+		return;
 	}
+	size_t curDepth = depth % K;
+	size_t nthIndex = (from + to) / 2;
+	T diff = target[curDepth] - m_pairs[nthIndex].first[curDepth];
+	if (diff < 0)
+		kNearest(target, k, depth + 1, from, nthIndex, heap);
+	else
+		kNearest(target, k, depth + 1, nthIndex + 1, to, heap);
+	if (m_alive[nthIndex])
+		pushBounded(heap, k, getSquaredDistance(target, m_pairs[nthIndex].first), nthIndex);
+	// The other branch can only contribute if the heap is not full or it is closer than the worst candidate
+	if (heap.size() < k || diff * diff < heap.top().first) {
+		if (diff < 0)
+			kNearest(target, k, depth + 1, nthIndex + 1, to, heap);
+		else
+			kNearest(target, k, depth + 1, from, nthIndex, heap);
+	}
+}
 
-	// If it is in the range, append it to the vector
-	if (inRange)
-		results.push_back({ node->point, node->data });
+// Push a candidate into the heap while keeping at most k candidates
+template <size_t K, class Data, class T>
+void KDTree<K, Data, T>::pushBounded(DistIndexHeap& heap, size_t k, T distance, size_t index) {
+	if (heap.size() < k) {
+		heap.push({ distance, index });
+	}
+	else if (distance < heap.top().first) {
+		heap.pop();
+		heap.push({ distance, index });
+	}
+}
 
+// private visitRange helper
+template <size_t K, class Data, class T>
+template <class Visitor>
+void KDTree<K, Data, T>::visitRange(const Point& lowerBound, const Point& upperBound,
+	size_t depth, size_t from, size_t to, Visitor& visitor) const {
+	if (to - from <= LeafSize) {
+		for (size_t i = from; i < to; ++i) {
+			if (m_alive[i] && isInRange(m_pairs[i].first, lowerBound, upperBound))
+				visitor(m_pairs[i].first, m_pairs[i].second);
+		}
+		return;
+	}
 	// Determine which branch to search
-	size_t nextDepth = (depth + 1) % K;
-	const T& curValue = node->point[depth];
-	if (curValue >= lowerBound[depth])
-		searchRange(node->left, lowerBound, upperBound, nextDepth, results);
-	if (curValue <= upperBound[depth])
-		searchRange(node->right, lowerBound, upperBound, nextDepth, results);
-}
\ No newline at end of file
+	size_t curDepth = depth % K;
+	size_t nthIndex = (from + to) / 2;
+	const T& curValue = m_pairs[nthIndex].first[curDepth];
+	if (m_alive[nthIndex] && isInRange(m_pairs[nthIndex].first, lowerBound, upperBound))
+		visitor(m_pairs[nthIndex].first, m_pairs[nthIndex].second);
+	if (curValue >= lowerBound[curDepth])
+		visitRange(lowerBound, upperBound, depth + 1, from, nthIndex, visitor);
+	if (curValue <= upperBound[curDepth])
+		visitRange(lowerBound, upperBound, depth + 1, nthIndex + 1, to, visitor);
+}
+
+// private visitRadius helper
+template <size_t K, class Data, class T>
+template <class Visitor>
+void KDTree<K, Data, T>::visitRadius(const Point& center, T squaredRadius,
+	size_t depth, size_t from, size_t to, Visitor& visitor) const {
+	if (to - from <= LeafSize) {
+		for (size_t i = from; i < to; ++i) {
+			if (m_alive[i] && getSquaredDistance(center, m_pairs[i].first) <= squaredRadius)
+				visitor(m_pairs[i].first, m_pairs[i].second);
+		}
+		return;
+	}
+	size_t curDepth = depth % K;
+	size_t nthIndex = (from + to) / 2;
+	T diff = center[curDepth] - m_pairs[nthIndex].first[curDepth];
+	if (m_alive[nthIndex] && getSquaredDistance(center, m_pairs[nthIndex].first) <= squaredRadius)
+		visitor(m_pairs[nthIndex].first, m_pairs[nthIndex].second);
+	// Skip a branch if the splitting plane is farther than the radius
+	if (diff <= 0 || diff * diff <= squaredRadius)
+		visitRadius(center, squaredRadius, depth + 1, from, nthIndex, visitor);
+	if (diff >= 0 || diff * diff <= squaredRadius)
+		visitRadius(center, squaredRadius, depth + 1, nthIndex + 1, to, visitor);
+}
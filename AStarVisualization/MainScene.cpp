@@ -1,23 +1,25 @@
 #include "MainScene.hpp"
+#include <cstdio>
+#include <stdexcept>
 
-std::shared_ptr<Entity> MainScene::createEditText(const std::string initialText, unsigned fontSize, float left, float top) {
+EntityHandle MainScene::createEditText(const std::string initialText, unsigned fontSize, float left, float top) {
 	auto entity = m_entityManager->addEntity();
 	auto cEdit = entity->addComponent<CText>(initialText, m_config.font, fontSize);
 	cEdit->text.setFillColor(sf::Color::White);
 	cEdit->states.transform.translate(left, top);
 	entity->addComponent<CClickable>([]() {return; });
-	return entity;
+	return entity->getHandle();
 }
-std::shared_ptr<Entity> MainScene::createLabel(const std::string initialText, unsigned fontSize, float left, float top, sf::Color color) {
+EntityHandle MainScene::createLabel(const std::string initialText, unsigned fontSize, float left, float top, sf::Color color) {
 	auto entity = m_entityManager->addEntity();
 	auto cEdit = entity->addComponent<CText>(initialText, m_config.font, fontSize);
 	cEdit->text.setFillColor(color);
 	cEdit->states.transform.translate(left, top);
 	cEdit->canEdit = false;
 	entity->addComponent<CClickable>([]() {return; });
-	return entity;
+	return entity->getHandle();
 }
-std::shared_ptr<Entity> MainScene::createButton(float left, float top, float width, float height, std::function<void()> listener) {
+EntityHandle MainScene::createButton(float left, float top, float width, float height, std::function<void()> listener) {
 	auto entity = m_entityManager->addEntity();
 	auto vertexArr = sf::VertexArray(sf::Quads, 4);
 	float halfWidth = width / 2.f, halfHeight = height / 2.f;
@@ -28,43 +30,11 @@ std::shared_ptr<Entity> MainScene::createButton(float left, float top, float wid
 	auto cShape = entity->addComponent<CShape>(vertexArr);
 	cShape->states.transform.translate(left, top);
 	entity->addComponent<CClickable>(listener);
-	return entity;
+	return entity->getHandle();
 }
-std::shared_ptr<Entity> MainScene::createBlock(float left, float top, float width, float height, sf::Color color) {
-	auto entity = m_entityManager->addEntity();
-	auto vertexArr = sf::VertexArray(sf::Quads, 4);
-	float halfWidth = width / 2.f, halfHeight = height / 2.f;
-	vertexArr[0].position = { 0, 0 };
-	vertexArr[1].position = { width, 0 };
-	vertexArr[2].position = { width, height };
-	vertexArr[3].position = { 0, height };
-	vertexArr[0].color = color;
-	vertexArr[1].color = color;
-	vertexArr[2].color = color;
-	vertexArr[3].color = color;
-	auto cShape = entity->addComponent<CShape>(vertexArr);
-	cShape->states.transform.translate(left, top);
-	auto cBlock = entity->addComponent<CBlock>();
-
-	entity->addComponent<CClickable>(
-		// Listener1
-		[cShape, cBlock, this]() {
-			cBlock->isObstacle = true;
-			setColor(cShape, obstacleColor);
-		},
-		// Listener2
-		[cShape, cBlock, this]() {
-			cBlock->isObstacle = false;
-			setColor(cShape, pathColor);
-		}
-	);
-	return entity;
-}
-
-
 void MainScene::updateNM() {
-	auto nText = nField->getComponent<CText>();
-	auto mText = mField->getComponent<CText>();
+	auto nText = getComponent<CText>(nField);
+	auto mText = getComponent<CText>(mField);
 	this->n = std::stoi(std::string(nText->text.getString()));
 	this->m = std::stoi(std::string(mText->text.getString()));
 	// Minimum value is 5
@@ -78,33 +48,82 @@ void MainScene::updateNM() {
 	}
 }
 
-void MainScene::setColor(std::shared_ptr<CShape> component, sf::Color color) {
+void MainScene::setColor(CShape* component, sf::Color color) {
 	auto& array = component->vertexArray;
 	if (array[0].color == color)
 		return;
 	size_t vertexSize = array.getVertexCount();
 	for (size_t i = 0; i < vertexSize; ++i)
 		array[i].color = color;
-	needRender = true;
+	m_dirtyRegion.add(component->states.transform.transformRect(array.getBounds()));
+}
+
+// Cells are drawn by the grid renderers, which re-upload only what changed
+void MainScene::setCellColor(size_t cell, sf::Color color) {
+	bool changed = m_useGridTexture ? m_gridTexture.setColor(cell, color) : m_grid.setColor(cell, color);
+	sf::FloatRect visible;
+	if (changed && m_gridTransform.transformRect(getCellBounds(cell)).intersects(gridViewport, visible))
+		m_dirtyRegion.add(visible);
+}
+
+// Area covered by the cell in grid coordinates
+sf::FloatRect MainScene::getCellBounds(size_t cell) const {
+	size_t i = cell / m, j = cell % m;
+	return { gridRect.left + j * m_blockSize, gridRect.top + i * m_blockSize, m_blockSize, m_blockSize };
+}
+
+// Zoom keeping the grid point under screenAnchor in place
+void MainScene::setZoom(float zoom, sf::Vector2f screenAnchor) {
+	zoom = std::clamp(zoom, 1.f, m_maxZoom);
+	auto anchor = m_gridTransform.getInverse().transformPoint(screenAnchor);
+	m_zoom = zoom;
+	setPan({ anchor.x - gridViewport.left - (screenAnchor.x - gridViewport.left) / zoom,
+		anchor.y - gridViewport.top - (screenAnchor.y - gridViewport.top) / zoom });
 }
 
-void MainScene::setText(std::shared_ptr<CText> component, std::string newText) {
+// pan is the grid offset shown at the top left corner of gridViewport, it is clamped to the grid
+void MainScene::setPan(sf::Vector2f pan) {
+	float maxX = std::max(gridRect.width - gridViewport.width / m_zoom, 0.f);
+	float maxY = std::max(gridRect.height - gridViewport.height / m_zoom, 0.f);
+	m_pan = { std::clamp(pan.x, 0.f, maxX), std::clamp(pan.y, 0.f, maxY) };
+	m_gridTransform = sf::Transform::Identity;
+	m_gridTransform.translate(gridViewport.left, gridViewport.top);
+	m_gridTransform.scale(m_zoom, m_zoom);
+	m_gridTransform.translate(-gridViewport.left - m_pan.x, -gridViewport.top - m_pan.y);
+	m_dirtyRegion.add(gridViewport);
+}
+
+void MainScene::setText(CText* component, std::string newText) {
 	auto& text = component->text;
+	// The old and the new text may cover different areas
+	m_dirtyRegion.add(component->states.transform.transformRect(text.getGlobalBounds()));
 	text.setString(newText);
-	needRender = true;
+	m_dirtyRegion.add(component->states.transform.transformRect(text.getGlobalBounds()));
 }
 
-void MainScene::setTextStyle(std::shared_ptr<CText> component, sf::Text::Style style) {
+void MainScene::setTextStyle(CText* component, sf::Text::Style style) {
 	auto& text = component->text;
+	m_dirtyRegion.add(component->states.transform.transformRect(text.getGlobalBounds()));
 	text.setStyle(style);
-	needRender = true;
+	m_dirtyRegion.add(component->states.transform.transformRect(text.getGlobalBounds()));
 }
 
 void MainScene::runAStar() {
 
 	if (!AStarStarted) {
+		clearSearch();
+		// Only admissible searches return optimal paths that can be cached
+		if (guidanceScaler <= 1) {
+			if (auto path = m_pathCache.find(m_startCell, m_endCell, m_mapVersion)) {
+				for (auto& step : *path)
+					showVisit(step.first, VisitState::ON_PATH);
+				showCacheHit();
+				return;
+			}
+		}
 		AStarStarted = true;
-		setColor(startButton->getComponent<CShape>(), grayColor);
+		setColor(getComponent<CShape>(startButton), grayColor);
+		showStats(nullptr);
 		float scaler{ guidanceScaler };
 		/*
 		AStar<Vertex>::shortestPath(graph, startM + m * startN, endM + m * endN,
@@ -113,39 +132,92 @@ void MainScene::runAStar() {
 				return scaler * (std::sqrt(powf(posA.first - posB.first, 2) + powf(posA.second - posB.second, 2)));
 			});
 		*/
-		AStar<Vertex>::shortestPath(graph, startM + m * startN, endM + m * endN,
+		// The search runs on the worker, update applies its progress
+		m_searchWorker.submit(m_obstacles, m_startCell, m_endCell,
 			[scaler](const std::pair<float, float>& posA, const std::pair<float, float>& posB) {
 				// Calculate the squared euclidian distance -> quite greedy
 				return scaler * (abs(posA.first - posB.first) + abs(posA.second - posB.second));
 			});
-		needRender = true;
 	}
 }
 
+// Color the visited blocks except the start and end blocks
+void MainScene::showVisit(size_t vertex, VisitState state) {
+	if (vertex == m_startCell || vertex == m_endCell)
+		return;
+	m_searchCells.push_back(vertex);
+	if (state == VisitState::OPENED)
+		setCellColor(vertex, openedColor);
+	else if (state == VisitState::CLOSED)
+		setCellColor(vertex, closedColor);
+	else
+		setCellColor(vertex, foundPathColor);
+}
 
-void MainScene::resetBlocks() {
-	// Clear blocks
-	for (auto& block : blocks) {
-		block->destroy();
+// Show the stats of a finished search next to the grid, nullptr clears them
+void MainScene::showStats(const AStarStats* stats) {
+	if (statsLabel.isNull())
+		return;
+	char text[256] = "";
+	if (stats) {
+		auto toMili = [](std::chrono::nanoseconds time) { return std::chrono::duration<double, std::milli>(time).count(); };
+		std::snprintf(text, sizeof(text),
+			"Expansions: %zu\nPushes: %zu\nDecrease keys: %zu\nPeak open list: %zu\nInitialize: %.2f ms\nSearch: %.2f ms\nPath: %.2f ms",
+			stats->expansions, stats->pushes, stats->decreaseKeys, stats->peakOpenSize,
+			toMili(stats->initializeTime), toMili(stats->searchTime), toMili(stats->reconstructTime));
 	}
-	blocks.clear();
+	setText(getComponent<CText>(statsLabel), text);
+}
+
+// Show the cache counters after a path was taken from the cache
+void MainScene::showCacheHit() {
+	if (statsLabel.isNull())
+		return;
+	char text[256];
+	std::snprintf(text, sizeof(text), "Path from the cache\nCache hits: %zu\nSubpath hits: %zu\nMisses: %zu",
+		m_pathCache.getHits(), m_pathCache.getSubpathHits(), m_pathCache.getMisses());
+	setText(getComponent<CText>(statsLabel), text);
+}
+
+// Restore the colors of the cells the last search colored
+void MainScene::clearSearch() {
+	for (size_t cell : m_searchCells)
+		setCellColor(cell, m_obstacles[cell] ? obstacleColor : pathColor);
+	m_searchCells.clear();
+}
+
+// The search has finished or was cancelled, enable the start button again
+void MainScene::finishSearch() {
+	AStarStarted = false;
+	if (!startButton.isNull())
+		setColor(getComponent<CShape>(startButton), sf::Color::White);
+}
+
+
+void MainScene::resetBlocks() {
+	PROFILE_FUNCTION();
+	// The running search belongs to the old grid
+	m_searchWorker.cancel();
+	m_pathCache = PathCache(m, n);
+	++m_mapVersion;
+	m_searchCells.clear();
 	// Creeate a graph with n*m vertices
-	graph = AdjacencyListGraph<Vertex>(n * m);
+	AdjacencyListGraph<Vertex> graph(n * m);
 	// Create blocks (570, 10) -> (1270, 710) // 700 X 700
 	float size = std::min(700.f / n, 700.f / m);
-	float halfSize = (size - 1) / 2.f;
-	blocks.reserve(n * m);
-	std::vector<std::pair<std::array<float, 2>, std::shared_ptr<Entity>>> pointBlockPairs;
+	m_blockSize = size;
+	// The blocks are drawn in chunks or from a texture rather than one shape per block
+	m_useGridTexture = n * m > ChunkedCellLimit;
+	if (m_useGridTexture)
+		m_gridTexture.reset(n, m, { 570, 10 }, size, pathColor);
+	else
+		m_grid.reset(n, m, { 570, 10 }, size, 1, pathColor);
+	m_dirtyRegion.addAll();
+	m_obstacles.assign(n * m, 0);
 	for (size_t i = 0; i < n; ++i) {
 		for (size_t j = 0; j < m; ++j) {
-			// Create a block & push them
-			float x = 570 + j * size, y = 10 + i * size;
-			auto blockEntity = createBlock(x, y, size - 1, size - 1, pathColor);
-			blocks.push_back(blockEntity);
-			pointBlockPairs.push_back({ { x + halfSize , y + halfSize }, blockEntity });
-
-			// Add edges (from, to, weight) to the graph to form a n * m grid
 			size_t cur = j + m * i;
+			// Add edges (from, to, weight) to the graph to form a n * m grid
 			if (j != 0)
 				graph.addEdge(cur, cur - 1, 1);
 			if (j != m - 1)
@@ -155,37 +227,58 @@ void MainScene::resetBlocks() {
 			if (i != n - 1)
 				graph.addEdge(cur, cur + m, 1);
 			graph.getVertexAttribute(cur).pos = { i, j };
-			graph.getVertexAttribute(cur).block = blockEntity;
 		}
 	}
-	// Build a K-D tree to efficiently search blocks
-	tree.buildTree(pointBlockPairs);
+	// The worker keeps the graph until the next reset, searches only send the obstacles
+	m_searchWorker.setGraph(std::move(graph));
 	// Set grid Range
 	gridRect.height = n * size;
 	gridRect.width = m * size;
-	startN = std::floorf(n * 0.15f);
-	startM = std::floorf(m * 0.15f);
-	endN = std::floorf(n * 0.85f);
-	endM = std::floorf(m * 0.85f);
+	m_zoom = 1;
+	setPan({ 0, 0 });
+	startN = std::floor(n * 0.15f);
+	startM = std::floor(m * 0.15f);
+	endN = std::floor(n * 0.85f);
+	endM = std::floor(m * 0.85f);
 
 	// Set start and end blocks
-	float startH = gridRect.top + startN * size;
-	float startW = gridRect.left + startM * size;
-	float endH = gridRect.top + endN * size;
-	float endW = gridRect.left + endM * size;
-
-	auto startBlock = tree.findNearestNeighbor({ startW, startH }).second;
-	startBlock->getComponent<CBlock>()->isStart = true;
-	setColor(startBlock->getComponent<CShape>(), startColor);
+	m_startCell = static_cast<size_t>(startM) + m * static_cast<size_t>(startN);
+	setCellColor(m_startCell, startColor);
 
-	auto endBlock = tree.findNearestNeighbor({ endW, endH }).second;
-	endBlock->getComponent<CBlock>()->isEnd = true;
-	setColor(endBlock->getComponent<CShape>(), endColor);
+	m_endCell = static_cast<size_t>(endM) + m * static_cast<size_t>(endN);
+	setCellColor(m_endCell, endColor);
 
 	// Enable path calculation
-	AStarStarted = false;
-	if (startButton)
-		setColor(startButton->getComponent<CShape>(), sf::Color::White);
+	finishSearch();
+	showStats(nullptr);
+}
+
+// Load a MovingAI map or a PGM image, see GridMap::load
+// The obstacles are moved into m_obstacles and colored in one pass, no entity is created per cell.
+// Maps with more than MaxMapCells cells throw before the scene is touched.
+void MainScene::loadMap(const std::string& fileName) {
+	PROFILE_FUNCTION();
+	auto map = GridMap::load(fileName);
+	if (map.getWidth() * map.getHeight() > MaxMapCells)
+		throw std::runtime_error(fileName + " is " + std::to_string(map.getWidth()) + " x " + std::to_string(map.getHeight())
+			+ ",\nmaps of up to " + std::to_string(MaxMapCells) + " cells can be shown");
+	n = map.getHeight();
+	m = map.getWidth();
+	setText(getComponent<CText>(nField), std::to_string(n));
+	setText(getComponent<CText>(mField), std::to_string(m));
+	resetBlocks();
+	m_obstacles = map.releaseObstacles();
+	// The start and end cells stay free
+	m_obstacles[m_startCell] = 0;
+	m_obstacles[m_endCell] = 0;
+	if (m_useGridTexture)
+		m_gridTexture.setColors(m_obstacles, pathColor, obstacleColor);
+	else
+		m_grid.setColors(m_obstacles, pathColor, obstacleColor);
+	setCellColor(m_startCell, startColor);
+	setCellColor(m_endCell, endColor);
+	// The cached paths belong to the empty grid
+	++m_mapVersion;
 }
 
 void MainScene::init() {
@@ -198,8 +291,18 @@ void MainScene::init() {
 	createLabel("N:", 36, fieldLeft, fieldTop);
 	// mLabel
 	createLabel("M:", 36, fieldLeft, fieldTop + 50);
-	// Create Blocks
-	resetBlocks();
+	// Create Blocks, from the configured map if it loads
+	std::string loadError;
+	if (!m_config.mapFile.empty()) {
+		try {
+			loadMap(m_config.mapFile);
+		}
+		catch (const std::exception& e) {
+			loadError = e.what();
+		}
+	}
+	if (m_config.mapFile.empty() || !loadError.empty())
+		resetBlocks();
 	// Create reset button
 	resetButton = createButton(fieldLeft + 50, fieldTop + 150, 100, 50, [this]() {
 		updateNM();
@@ -213,6 +316,10 @@ void MainScene::init() {
 		});
 	// Create start button label
 	createLabel("Start", 36, fieldLeft + 10, fieldTop + 200, sf::Color::Red);
+	// Create the search stats label
+	statsLabel = createLabel("", 20, fieldLeft, fieldTop + 300);
+	if (!loadError.empty())
+		setText(getComponent<CText>(statsLabel), "Could not load the map\n" + loadError);
 }
 
 void MainScene::handleMouseInput(sf::Event& event) {
@@ -224,7 +331,7 @@ void MainScene::handleMouseInput(sf::Event& event) {
 			float mouseY = event.mouseButton.y;
 			// Check text fields
 			for (auto& entity : { nField, mField }) {
-				auto cText = entity->getComponent<CText>();
+				auto cText = getComponent<CText>(entity);
 				// Reset focus
 				cText->focused = false;
 				auto& text = cText->text;
@@ -237,14 +344,15 @@ void MainScene::handleMouseInput(sf::Event& event) {
 				}
 			}
 			// Check buttons
-			for (auto& entity : { resetButton, startButton }) {
-				auto cShape = entity->getComponent<CShape>();
-				auto bound = cShape->states.transform.transformRect(cShape->vertexArray.getBounds());
-				auto cClick = entity->getComponent<CClickable>();
-				if (cClick->isActive && bound.contains(mouseX, mouseY)) {
-					cClick->onClickListener();
-				}
-			}
+			std::vector<std::function<void()>> listeners;
+			m_entityManager->view<CShape, CClickable>().each([&](CShape& cShape, CClickable& cClick) {
+				auto bound = cShape.states.transform.transformRect(cShape.vertexArray.getBounds());
+				if (cClick.isActive && bound.contains(mouseX, mouseY))
+					listeners.push_back(cClick.onClickListener);
+				});
+			// Call them after the view, a listener may create entities and move the components
+			for (auto& listener : listeners)
+				listener();
 		}
 		else {
 			leftPressing = false;
@@ -255,6 +363,12 @@ void MainScene::handleMouseInput(sf::Event& event) {
 		isMousePressing = false;
 		m_mousePressingSecondTime = false;
 	}
+	// The mouse wheel zooms the grid around the cursor
+	else if (event.type == sf::Event::MouseWheelScrolled) {
+		sf::Vector2f mouse(event.mouseWheelScroll.x, event.mouseWheelScroll.y);
+		if (event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel && gridViewport.contains(mouse))
+			setZoom(m_zoom * std::pow(1.25f, event.mouseWheelScroll.delta), mouse);
+	}
 		
 
 
@@ -264,7 +378,7 @@ void MainScene::handleKeyBoardInput(sf::Event& event) {
 	if (event.type == sf::Event::TextEntered) {
 		// Edit focused text
 		for (auto& entity : { nField, mField }) {
-			auto cText = entity->getComponent<CText>();
+			auto cText = getComponent<CText>(entity);
 			auto& text = cText->text;
 			auto& str = text.getString();
 			auto code = event.text.unicode;
@@ -287,53 +401,141 @@ void MainScene::handleKeyBoardInput(sf::Event& event) {
 				}
 			}
 		}
+		// '[' and ']' shrink and grow the brush
+		if (event.text.unicode == '[')
+			m_brushRadius = std::max(m_brushRadius - 1, 0);
+		else if (event.text.unicode == ']')
+			m_brushRadius = std::min(m_brushRadius + 1, m_maxBrushRadius);
+	}
+	// Arrow keys pan the zoomed grid
+	else if (event.type == sf::Event::KeyPressed) {
+		float step = 50.f / m_zoom;
+		if (event.key.code == sf::Keyboard::Left)
+			setPan({ m_pan.x - step, m_pan.y });
+		else if (event.key.code == sf::Keyboard::Right)
+			setPan({ m_pan.x + step, m_pan.y });
+		else if (event.key.code == sf::Keyboard::Up)
+			setPan({ m_pan.x, m_pan.y - step });
+		else if (event.key.code == sf::Keyboard::Down)
+			setPan({ m_pan.x, m_pan.y + step });
 	}
 }
 
 void MainScene::update(sf::RenderWindow& window) {
-	// Change the color of the block under the mouse cursor
+	// Show the progress of the search
+	if (m_searchWorker.isRunning()) {
+		m_searchWorker.poll([this](size_t vertex, VisitState state) {
+			showVisit(vertex, state);
+			}, m_config.searchMiliPerFrame);
+		if (!m_searchWorker.isRunning()) {
+			showStats(&m_searchWorker.getStats());
+			if (guidanceScaler <= 1)
+				m_pathCache.insert(m_startCell, m_endCell, m_mapVersion, m_searchWorker.getPath());
+			finishSearch();
+		}
+	}
+	// Paint the cells the cursor crossed since the last frame
 	if (isMousePressing) {
 		auto mousePos = sf::Mouse::getPosition(window);
 		float mouseX = mousePos.x;
 		float mouseY = mousePos.y;
-		std::vector<std::pair<float, float>> mousePositions;
-		mousePositions.reserve(m_mouseSplits);
-		mousePositions.push_back({ mouseX, mouseY });
-		if (m_mousePressingSecondTime) {
-			float xDiff = (m_lastMouseX - mouseX)/m_mouseSplits;
-			float yDiff = (m_lastMouseY - mouseY)/m_mouseSplits;
-			float xOffset = xDiff;
-			float yOffset = yDiff;
-			for (unsigned i = 1; i < m_mouseSplits; ++i) {
-				mousePositions.push_back({ mouseX + xOffset, mouseY + yOffset });
-				xOffset += xDiff;
-				yOffset += yDiff;
-			}
+		if (!gridViewport.contains(mouseX, mouseY)) {
+			// The stroke restarts where the cursor enters the grid again
+			m_mousePressingSecondTime = false;
+			return;
 		}
-		else {
+		sf::Vector2f from(mouseX, mouseY);
+		if (m_mousePressingSecondTime)
+			from = { m_lastMouseX, m_lastMouseY };
+		else
 			m_mousePressingSecondTime = true;
-		}
 		m_lastMouseX = mouseX;
 		m_lastMouseY = mouseY;
 
-		for (auto [mouseX, mouseY] : mousePositions) {
-			if (gridRect.contains(mouseX, mouseY)) {
-				auto nearestButton = tree.findNearestNeighbor({ mouseX, mouseY }).second;
-				auto cClick = nearestButton->getComponent<CClickable>();
-				auto cBlock = nearestButton->getComponent<CBlock>();
-				if (cClick->isActive && !cBlock->isStart && !cBlock->isEnd) {
-					if (leftPressing)
-						cClick->onClickListener();
-					else
-						cClick->additionalListener();
-				}
-			}
-		}
+		collectStroke(from, { mouseX, mouseY });
+		// Left button places obstacles, the other buttons remove them
+		paintCells(m_paintCells, leftPressing);
+	}
+}
+
+// Collect the cells under the segment between two screen positions into m_paintCells
+// The segment is rasterized in cell coordinates, each crossed cell is stamped with the brush
+// and every cell is collected once, so the cost is proportional to the cells crossed.
+void MainScene::collectStroke(sf::Vector2f from, sf::Vector2f to) {
+	m_paintCells.clear();
+	if (m_paintStamps.size() != n * m)
+		m_paintStamps.assign(n * m, 0);
+	if (++m_paintStamp == 0) {
+		// Wrapped around, forget the old stamps
+		std::fill(m_paintStamps.begin(), m_paintStamps.end(), 0);
+		m_paintStamp = 1;
+	}
+	auto screenToGrid = m_gridTransform.getInverse();
+	auto a = screenToGrid.transformPoint(from), b = screenToGrid.transformPoint(to);
+	GridRaster::traverseSegment(
+		(a.x - gridRect.left) / m_blockSize, (a.y - gridRect.top) / m_blockSize,
+		(b.x - gridRect.left) / m_blockSize, (b.y - gridRect.top) / m_blockSize,
+		[this](int x, int y) {
+			if (m_brushRadius == 0)
+				collectCell(x, y);
+			else
+				GridRaster::stampDisc(x, y, m_brushRadius, [this](int x, int y) { collectCell(x, y); });
+		});
+}
+
+// Add a cell to m_paintCells once per stroke, cells outside of the grid are ignored
+void MainScene::collectCell(int x, int y) {
+	if (x < 0 || y < 0 || x >= static_cast<int>(m) || y >= static_cast<int>(n))
+		return;
+	size_t cell = x + m * y;
+	if (m_paintStamps[cell] != m_paintStamp) {
+		m_paintStamps[cell] = m_paintStamp;
+		m_paintCells.push_back(cell);
 	}
 }
 
-bool MainScene::getNeedRender() {
-	bool need = needRender;
-	needRender = false;
-	return need;
-}
\ No newline at end of file
+// Set the obstacle state of a batch of cells and recolor the cells that changed
+// The start and end cells and the cells already in the requested state are skipped,
+// so repeated cells cost one byte compare.
+void MainScene::paintCells(const std::vector<size_t>& cells, bool obstacle) {
+	uint8_t state = obstacle ? 1 : 0;
+	sf::Color color = obstacle ? obstacleColor : pathColor;
+	m_editedCells.clear();
+	for (size_t cell : cells) {
+		if (m_obstacles[cell] == state || cell == m_startCell || cell == m_endCell)
+			continue;
+		m_obstacles[cell] = state;
+		setCellColor(cell, color);
+		m_editedCells.push_back(cell);
+	}
+	if (m_editedCells.empty())
+		return;
+	// Keep the cached paths the edit can not affect
+	m_pathCache.invalidate(m_editedCells, obstacle, ++m_mapVersion);
+	// The running search works on the old obstacles, its partial colors are not a result
+	if (m_searchWorker.isRunning()) {
+		m_searchWorker.cancel();
+		clearSearch();
+		finishSearch();
+	}
+}
+
+// Painting follows the held mouse and a running search delivers its progress every frame
+bool MainScene::isAnimating() {
+	return isMousePressing || m_searchWorker.isRunning();
+}
+
+void MainScene::draw(sf::RenderTarget& target, const sf::FloatRect& region) {
+	// Clip the grid to its viewport
+	sf::FloatRect clip;
+	if (!region.intersects(gridViewport, clip))
+		return;
+	auto previousView = target.getView();
+	target.setView(DirtyRegion::getClipView(target.getSize(), clip));
+	sf::RenderStates states(m_gridTransform);
+	if (m_useGridTexture)
+		m_gridTexture.draw(target, m_blockSize * m_zoom, states);
+	else
+		m_grid.draw(target, m_gridTransform.getInverse().transformRect(clip), states);
+	target.setView(previousView);
+}
@@ -1,7 +1,12 @@
 #pragma once
 #include "Scene.hpp"
-#include "KDTree.hpp"
-#include "AStar.hpp"
+#include "SearchWorker.hpp"
+#include "GridRenderer.hpp"
+#include "GridTexture.hpp"
+#include "GridRaster.hpp"
+#include "GridMap.hpp"
+#include "PathCache.hpp"
+#include "Profiler.hpp"
 #include <cmath>
 
 //Concrete Scenes
@@ -13,26 +18,59 @@ private:
 		std::pair<float, float> pos;
 		float gScore, fScore;
 		size_t parent;
-		std::shared_ptr<Entity> block;
 	};
 
 	size_t n{ 10 }, m{ 10 };
-	std::shared_ptr<Entity> nField;
-	std::shared_ptr<Entity> mField;
+	EntityHandle nField;
+	EntityHandle mField;
 
-	std::shared_ptr<Entity> resetButton;
-	std::shared_ptr<Entity> startButton;
+	EntityHandle resetButton;
+	EntityHandle startButton;
+	// Counters and timings of the last search
+	EntityHandle statsLabel;
 	float startN{};
 	float startM{};
 	float endN{};
 	float endM{};
-	std::vector<std::shared_ptr<Entity>> blocks;
-	KDTree<2, std::shared_ptr<Entity>> tree;
-	AdjacencyListGraph<Vertex> graph{0};
+	// Cells have no entities, a cell id is the index of its graph vertex
+	// 1 if the cell is an obstacle, indexed by cell id
+	std::vector<uint8_t> m_obstacles;
+	size_t m_startCell{ 0 };
+	size_t m_endCell{ 0 };
+	// Cells touched by the brush this frame
+	std::vector<size_t> m_paintCells;
+	// A cell is already in m_paintCells if its stamp equals m_paintStamp
+	std::vector<uint32_t> m_paintStamps;
+	uint32_t m_paintStamp{ 0 };
+	GridRenderer m_grid;
+	// Grids with more cells than ChunkedCellLimit are drawn from a texture instead of chunked quads
+	GridTexture m_gridTexture;
+	static constexpr size_t ChunkedCellLimit = 256 * 256;
+	// Every cell is a vertex of the search graph, loadMap rejects larger maps instead of running out of memory
+	static constexpr size_t MaxMapCells = 2048 * 2048;
+	bool m_useGridTexture{ false };
+	// Pan and zoom of the grid inside gridViewport, gridTransform maps grid coordinates to the screen
+	sf::FloatRect gridViewport{ 570, 10, 700, 700 };
+	sf::Transform m_gridTransform;
+	float m_zoom{ 1 };
+	float m_maxZoom{ 64 };
+	sf::Vector2f m_pan{ 0, 0 };
+	// Runs the searches off the UI thread
+	SearchWorker<Vertex> m_searchWorker;
+	// Paths of the earlier searches, m_mapVersion changes with every edit of the obstacles
+	PathCache m_pathCache;
+	uint64_t m_mapVersion{ 0 };
+	// Cells colored by the last search
+	std::vector<size_t> m_searchCells;
+	// Cells changed by the last paintCells
+	std::vector<size_t> m_editedCells;
 
 	bool m_mousePressingSecondTime{ false };
 	float m_lastMouseX{ 0 }, m_lastMouseY{ 0 };
-	int m_mouseSplits{ 5 };
+	// Brush radius in blocks, 0 paints the single block under the cursor
+	int m_brushRadius{ 0 };
+	int m_maxBrushRadius{ 20 };
+	float m_blockSize{ 0 };
 
 	sf::FloatRect gridRect{570, 10, 700, 700};
 	sf::Color pathColor = sf::Color(154, 123, 79, 255);
@@ -40,29 +78,47 @@ private:
 	sf::Color startColor = sf::Color::Blue;
 	sf::Color endColor = sf::Color::Red;
 	sf::Color grayColor = sf::Color(155, 155, 155, 255);
+	sf::Color openedColor = sf::Color::White;
+	sf::Color closedColor = sf::Color::Green;
+	sf::Color foundPathColor = sf::Color(255, 0, 255, 255);
 	bool isMousePressing{ false };
 	bool leftPressing{ false };
 	bool AStarStarted{ false };
-	bool needRender{ false };
 	float guidanceScaler{ 1.0f };
 public:
 	void init() override;
 	void handleMouseInput(sf::Event& event) override;
 	void handleKeyBoardInput(sf::Event& event) override;
 	void update(sf::RenderWindow& window) override;
-	bool getNeedRender() override;
+	bool isAnimating() override;
+	void draw(sf::RenderTarget& target, const sf::FloatRect& region) override;
 private:
-	std::shared_ptr<Entity> createEditText(const std::string initialText, unsigned fontSize, float left, float top);
-	std::shared_ptr<Entity> createLabel(const std::string initialText, unsigned fontSize, float left, float top, sf::Color color = sf::Color::White);
-	std::shared_ptr<Entity> createButton(float left, float top, float width, float height, std::function<void()> listener);
-	std::shared_ptr<Entity> createBlock(float left, float top, float width, float height, sf::Color color = sf::Color::White);
+	EntityHandle createEditText(const std::string initialText, unsigned fontSize, float left, float top);
+	EntityHandle createLabel(const std::string initialText, unsigned fontSize, float left, float top, sf::Color color = sf::Color::White);
+	EntityHandle createButton(float left, float top, float width, float height, std::function<void()> listener);
+	template <class T> T* getComponent(EntityHandle handle);
 	void updateNM();
-	void setColor(std::shared_ptr<CShape> component, sf::Color color);
-	void setText(std::shared_ptr<CText> component, std::string newText);
-	void setTextStyle(std::shared_ptr<CText> component, sf::Text::Style style);
+	void setColor(CShape* component, sf::Color color);
+	void setCellColor(size_t cell, sf::Color color);
+	sf::FloatRect getCellBounds(size_t cell) const;
+	void setZoom(float zoom, sf::Vector2f screenAnchor);
+	void setPan(sf::Vector2f pan);
+	void setText(CText* component, std::string newText);
+	void setTextStyle(CText* component, sf::Text::Style style);
+	void paintCells(const std::vector<size_t>& cells, bool obstacle);
+	void collectStroke(sf::Vector2f from, sf::Vector2f to);
+	void collectCell(int x, int y);
 	void runAStar();
+	void showVisit(size_t vertex, VisitState state);
+	void showStats(const AStarStats* stats);
+	void showCacheHit();
+	void clearSearch();
+	void finishSearch();
 	void resetBlocks();
+	void loadMap(const std::string& fileName);
 };
 
-
-
+template <class T>
+T* MainScene::getComponent(EntityHandle handle) {
+	return m_entityManager->getComponent<T>(handle);
+}
@@ -0,0 +1,241 @@
+#pragma once
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <optional>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cmath>
+
+// Cache of optimal paths between the cells of a grid, the id of the cell (x, y) is x + width * y
+// Entries are keyed by (source, target) and the map version they were computed on.
+// Any part of an optimal path is optimal too, so a query is also answered by a cached path that passes
+// through both of its cells. The graph must be undirected, a path read backwards answers the reverse query.
+// invalidate evicts only the paths an edit can affect: the paths through (or, with diagonal moves, next to)
+// cells that became obstacles, and the paths that the cells that became free (or, with diagonal moves,
+// the corners they free) could shorten according to a lower bound of the grid distance.
+class PathCache
+{
+public:
+	using Path = std::vector<std::pair<size_t, float>>;
+	PathCache(size_t width = 0, size_t height = 0, bool diagonal = false, size_t capacity = 1024);
+	std::optional<Path> find(size_t from, size_t to, uint64_t version);
+	void insert(size_t from, size_t to, uint64_t version, const Path& path);
+	void invalidate(const std::vector<size_t>& cells, bool blocked, uint64_t version);
+	void clear();
+	size_t getSize() const;
+	size_t getHits() const;
+	size_t getSubpathHits() const;
+	size_t getMisses() const;
+private:
+	struct Entry {
+		size_t from, to;
+		Path path;
+		std::list<uint64_t>::iterator lru;
+	};
+	struct KeyHash {
+		size_t operator()(const std::pair<size_t, size_t>& key) const {
+			return std::hash<size_t>()(key.first) * 31 + std::hash<size_t>()(key.second);
+		}
+	};
+	size_t m_width;
+	size_t m_height;
+	bool m_diagonal;
+	size_t m_capacity;
+	uint64_t m_version{ 0 };
+	uint64_t m_nextId{ 0 };
+	std::unordered_map<uint64_t, Entry> m_entries;
+	std::unordered_map<std::pair<size_t, size_t>, uint64_t, KeyHash> m_keys;
+	// (entry id, index in its path) of the cached paths through each cell
+	std::unordered_map<size_t, std::vector<std::pair<uint64_t, size_t>>> m_cellIndex;
+	// Most recently used entry first
+	std::list<uint64_t> m_lru;
+	size_t m_hits{ 0 }, m_subpathHits{ 0 }, m_misses{ 0 };
+	void setVersion(uint64_t version);
+	void erase(uint64_t id);
+	static Path slice(const Path& path, size_t begin, size_t end);
+	float getDistanceBound(float dx, float dy) const;
+};
+
+inline PathCache::PathCache(size_t width, size_t height, bool diagonal, size_t capacity)
+	: m_width(width), m_height(height), m_diagonal(diagonal), m_capacity(std::max<size_t>(1, capacity)) {}
+
+// Path from the source to the target with the cost of each cell, or nothing on a miss
+inline std::optional<PathCache::Path> PathCache::find(size_t from, size_t to, uint64_t version) {
+	setVersion(version);
+	for (auto key : { std::make_pair(from, to), std::make_pair(to, from) }) {
+		auto it = m_keys.find(key);
+		if (it == m_keys.end())
+			continue;
+		auto& entry = m_entries.at(it->second);
+		m_lru.splice(m_lru.begin(), m_lru, entry.lru);
+		++m_hits;
+		if (key.first == from)
+			return entry.path;
+		return slice(entry.path, entry.path.size() - 1, 0);
+	}
+	auto fromCells = m_cellIndex.find(from), toCells = m_cellIndex.find(to);
+	if (fromCells != m_cellIndex.end() && toCells != m_cellIndex.end()) {
+		for (auto& [id, begin] : fromCells->second) {
+			for (auto& [otherId, end] : toCells->second) {
+				if (id != otherId)
+					continue;
+				auto& entry = m_entries.at(id);
+				m_lru.splice(m_lru.begin(), m_lru, entry.lru);
+				++m_subpathHits;
+				return slice(entry.path, begin, end);
+			}
+		}
+	}
+	++m_misses;
+	return std::nullopt;
+}
+
+// Cache an optimal path from the source to the target, paths that do not reach the target are not cached
+inline void PathCache::insert(size_t from, size_t to, uint64_t version, const Path& path) {
+	setVersion(version);
+	if (path.empty() || path.front().first != from || path.back().first != to || !std::isfinite(path.back().second))
+		return;
+	auto key = std::make_pair(from, to);
+	auto it = m_keys.find(key);
+	if (it != m_keys.end())
+		erase(it->second);
+	uint64_t id = m_nextId++;
+	m_lru.push_front(id);
+	m_entries.emplace(id, Entry{ from, to, path, m_lru.begin() });
+	m_keys.emplace(key, id);
+	for (size_t i = 0; i < path.size(); ++i)
+		m_cellIndex[path[i].first].push_back({ id, i });
+	if (m_entries.size() > m_capacity)
+		erase(m_lru.back());
+}
+
+// The cells were set to blocked or free, the map is now at version
+inline void PathCache::invalidate(const std::vector<size_t>& cells, bool blocked, uint64_t version) {
+	std::vector<uint64_t> evicted;
+	if (blocked) {
+		auto evictThrough = [&](size_t cell) {
+			auto it = m_cellIndex.find(cell);
+			if (it == m_cellIndex.end())
+				return;
+			for (auto& [id, index] : it->second)
+				evicted.push_back(id);
+		};
+		for (size_t cell : cells) {
+			if (!m_diagonal || m_width == 0) {
+				evictThrough(cell);
+				continue;
+			}
+			// A diagonal move may not cut the corner of an obstacle, so the paths next to it are affected too
+			size_t x = cell % m_width, y = cell / m_width;
+			for (size_t dy = 0; dy < 3; ++dy) {
+				for (size_t dx = 0; dx < 3; ++dx) {
+					if ((x == 0 && dx == 0) || (x + 1 == m_width && dx == 2) || (y == 0 && dy == 0) || (y + 1 == m_height && dy == 2))
+						continue;
+					evictThrough(cell + dx + m_width * dy - 1 - m_width);
+				}
+			}
+		}
+	}
+	else if (!cells.empty() && m_width != 0) {
+		// A path through the freed region is at least as long as the bound through its bounding box
+		size_t left = std::numeric_limits<size_t>::max(), top = left, right = 0, bottom = 0;
+		for (size_t cell : cells) {
+			size_t x = cell % m_width, y = cell / m_width;
+			left = std::min(left, x), right = std::max(right, x);
+			top = std::min(top, y), bottom = std::max(bottom, y);
+		}
+		// A freed cell also enables the diagonal moves between its neighbors that cut its corner,
+		// so with diagonal moves the region grows by one cell on every side
+		float margin = m_diagonal ? 1.f : 0.f;
+		float regionLeft = static_cast<float>(left) - margin, regionRight = static_cast<float>(right) + margin;
+		float regionTop = static_cast<float>(top) - margin, regionBottom = static_cast<float>(bottom) + margin;
+		auto boundToRegion = [&](size_t cell) {
+			float x = static_cast<float>(cell % m_width), y = static_cast<float>(cell / m_width);
+			float dx = std::max({ 0.f, regionLeft - x, x - regionRight });
+			float dy = std::max({ 0.f, regionTop - y, y - regionBottom });
+			return getDistanceBound(dx, dy);
+		};
+		for (auto& [id, entry] : m_entries) {
+			float cost = entry.path.back().second - entry.path.front().second;
+			if (boundToRegion(entry.from) + boundToRegion(entry.to) < cost - 1e-3f)
+				evicted.push_back(id);
+		}
+	}
+	for (auto id : evicted) {
+		if (m_entries.count(id))
+			erase(id);
+	}
+	m_version = version;
+}
+
+inline void PathCache::clear() {
+	m_entries.clear();
+	m_keys.clear();
+	m_cellIndex.clear();
+	m_lru.clear();
+}
+
+inline size_t PathCache::getSize() const {
+	return m_entries.size();
+}
+
+// Queries answered by a cached path between the same cells
+inline size_t PathCache::getHits() const {
+	return m_hits;
+}
+
+// Queries answered by a part of a longer cached path
+inline size_t PathCache::getSubpathHits() const {
+	return m_subpathHits;
+}
+
+inline size_t PathCache::getMisses() const {
+	return m_misses;
+}
+
+// The map changed without invalidate, nothing cached is known to be valid
+inline void PathCache::setVersion(uint64_t version) {
+	if (version != m_version) {
+		clear();
+		m_version = version;
+	}
+}
+
+inline void PathCache::erase(uint64_t id) {
+	auto it = m_entries.find(id);
+	auto& entry = it->second;
+	for (auto& step : entry.path) {
+		auto cell = m_cellIndex.find(step.first);
+		auto& ids = cell->second;
+		ids.erase(std::find_if(ids.begin(), ids.end(), [id](auto& item) { return item.first == id; }));
+		if (ids.empty())
+			m_cellIndex.erase(cell);
+	}
+	m_keys.erase({ entry.from, entry.to });
+	m_lru.erase(entry.lru);
+	m_entries.erase(it);
+}
+
+// Cells begin to end of a path, in either direction, with the costs counted from begin
+inline PathCache::Path PathCache::slice(const Path& path, size_t begin, size_t end) {
+	Path result;
+	float base = path[begin].second;
+	if (begin <= end) {
+		for (size_t i = begin; i <= end; ++i)
+			result.push_back({ path[i].first, path[i].second - base });
+	}
+	else {
+		for (size_t i = begin + 1; i-- > end;)
+			result.push_back({ path[i].first, base - path[i].second });
+	}
+	return result;
+}
+
+// Lower bound of the cost between cells dx columns and dy rows apart, edges cost at least 1 per step
+inline float PathCache::getDistanceBound(float dx, float dy) const {
+	if (m_diagonal)
+		return std::max(dx, dy) + (std::sqrt(2.f) - 1) * std::min(dx, dy);
+	return dx + dy;
+}
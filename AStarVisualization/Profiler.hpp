@@ -1,78 +1,250 @@
 #pragma once
+#include "SpscQueue.hpp"
 #include <fstream>
-#include <format>
+#include <string>
 #include <string_view>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <cstdint>
 
 namespace prof {
+	// Binary trace format written by the Profiler, "ProfileConverter" turns it into Chrome trace JSON
+	// The stream starts with Magic and Version, followed by records that start with a RecordType byte:
+	// NAME    : uint32 name id, uint32 length, length bytes of the name
+	// SCOPE   : uint32 name id, uint32 thread index, int64 start, int64 duration, uint64 allocations, uint64 allocated bytes
+	// COUNTER : uint32 name id, uint32 thread index, int64 time, int64 value
+	// Times are nanoseconds since the profiler started
+	namespace format {
+		constexpr char Magic[4] = { 'P', 'R', 'O', 'F' };
+		constexpr uint32_t Version = 2;
+		enum class RecordType : uint8_t { NAME = 1, SCOPE = 2, COUNTER = 3 };
+	}
+
+	// Heap allocations made by the current thread, counted by the operator new in AllocationTracker.cpp
+	namespace detail {
+		inline thread_local uint64_t allocations = 0;
+		inline thread_local uint64_t allocatedBytes = 0;
+	}
+
+	// Raw event as recorded by InstrumentationTimer and counters
+	// value is the duration of a scope or the value of a counter
+	struct TraceEvent {
+		uint32_t nameId{ 0 };
+		format::RecordType type{ format::RecordType::SCOPE };
+		int64_t time{ 0 };
+		int64_t value{ 0 };
+		uint64_t allocations{ 0 };
+		uint64_t allocatedBytes{ 0 };
+	};
+
 	// Singleton Profiler
-	// RAII style
+	// Each thread records into its own lock-free ring buffer without allocating or formatting,
+	// a background thread drains the buffers and writes the binary format above.
+	// Events are dropped, and counted, when a thread records faster than the flusher drains.
+	// The count is written as the last sample of the "Dropped events" counter when the profiler is destroyed.
+	// Nothing is recorded, and the profiler is not even created, until it is enabled at runtime.
 	class Profiler
 	{
-	private:
-		std::ofstream m_outFile;
 	public:
-		// Times are given in microseconds
-		static void processTrace(std::string_view name, long long duration, long long startTime, size_t threadID) {
+		static constexpr size_t BufferCapacity = 1 << 14;
+		static constexpr std::chrono::milliseconds FlushInterval{ 10 };
+		static Profiler& instance() {
 			static Profiler profiler;
-			profiler.writeTrace(name, duration, startTime, threadID);
+			return profiler;
+		}
+		static bool isEnabled() {
+			return s_enabled.load(std::memory_order_relaxed);
+		}
+		static void setEnabled(bool enabled) {
+			if (enabled)
+				instance();
+			s_enabled.store(enabled, std::memory_order_relaxed);
+		}
+		// Called once per profiled scope or counter, the id identifies the name in the events
+		static uint32_t registerName(std::string_view name) {
+			auto& registry = names();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			registry.names.emplace_back(name);
+			return static_cast<uint32_t>(registry.names.size() - 1);
+		}
+		void record(const TraceEvent& event) {
+			thread_local ThreadBuffer* buffer = registerThread();
+			if (!buffer->events.tryPush(event))
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+		void recordCounter(uint32_t nameId, int64_t value) {
+			record(TraceEvent{ nameId, format::RecordType::COUNTER, now(), value });
+		}
+		int64_t now() const {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_epoch).count();
+		}
+		size_t getDroppedCount() const {
+			return m_dropped.load(std::memory_order_relaxed);
 		}
 	private:
-		Profiler(const std::string& fileName = "profile_result.json") {
-			m_outFile.open(fileName);
-			m_outFile << "{\"traceEvents\":[";
+		using Clock = std::chrono::steady_clock;
+		struct ThreadBuffer {
+			uint32_t threadIndex;
+			SpscQueue<TraceEvent> events;
+			explicit ThreadBuffer(uint32_t index) : threadIndex(index), events(BufferCapacity) {}
+		};
+		struct NameRegistry {
+			std::mutex mutex;
+			std::vector<std::string> names;
+		};
+		static inline std::atomic<bool> s_enabled{ false };
+		std::ofstream m_outFile;
+		Clock::time_point m_epoch{ Clock::now() };
+		// Buffers are owned by the profiler, so they outlive the threads that record into them
+		std::mutex m_buffersMutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+		size_t m_writtenNames{ 0 };
+		std::atomic<size_t> m_dropped{ 0 };
+		std::mutex m_flushMutex;
+		std::condition_variable m_flushCondition;
+		bool m_stop{ false };
+		std::thread m_flusher;
+
+		// The registry lives apart from the profiler so registering names does not create it
+		static NameRegistry& names() {
+			static NameRegistry registry;
+			return registry;
+		}
+		Profiler(const std::string& fileName = "profile_result.bin") {
+			// Construct the registry first so it is destroyed after the final flush
+			names();
+			m_outFile.open(fileName, std::ios::binary);
+			m_outFile.write(format::Magic, sizeof(format::Magic));
+			write(format::Version);
+			m_flusher = std::thread([this]() { runFlusher(); });
 		}
 		Profiler(const Profiler&) = delete;
 		Profiler& operator=(const Profiler&) = delete;
 		~Profiler() {
-			size_t pos = m_outFile.tellp();
-			// Erase the last comma
-			m_outFile.seekp(pos - 1);
-			m_outFile << "]}";
-			m_outFile.flush();
+			{
+				std::lock_guard<std::mutex> lock(m_flushMutex);
+				m_stop = true;
+			}
+			m_flushCondition.notify_one();
+			m_flusher.join();
+			flush();
+			if (size_t dropped = getDroppedCount()) {
+				uint32_t nameId = registerName("Dropped events");
+				flush();
+				write(format::RecordType::COUNTER);
+				write(nameId);
+				write(uint32_t{ 0 });
+				write(now());
+				write(static_cast<int64_t>(dropped));
+			}
 			m_outFile.close();
 		}
-		void writeTrace(std::string_view name, long long duration, long long startTime, size_t threadID) {
-			m_outFile << "{" + std::format("\"name\":\"{}\",\"dur\":{},\"ph\":\"X\",\"pid\":0,\"tid\":{},\"ts\":{}", name, duration, threadID, startTime) + "},";
+		ThreadBuffer* registerThread() {
+			std::lock_guard<std::mutex> lock(m_buffersMutex);
+			m_buffers.push_back(std::make_unique<ThreadBuffer>(static_cast<uint32_t>(m_buffers.size())));
+			return m_buffers.back().get();
+		}
+		void runFlusher() {
+			std::unique_lock<std::mutex> lock(m_flushMutex);
+			while (!m_stop) {
+				m_flushCondition.wait_for(lock, FlushInterval);
+				flush();
+			}
+		}
+		// Write the new names and drain every buffer
+		void flush() {
+			{
+				auto& registry = names();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				for (; m_writtenNames < registry.names.size(); ++m_writtenNames) {
+					auto& name = registry.names[m_writtenNames];
+					write(format::RecordType::NAME);
+					write(static_cast<uint32_t>(m_writtenNames));
+					write(static_cast<uint32_t>(name.size()));
+					m_outFile.write(name.data(), name.size());
+				}
+			}
+			std::lock_guard<std::mutex> lock(m_buffersMutex);
+			TraceEvent event;
+			for (auto& buffer : m_buffers) {
+				while (buffer->events.tryPop(event)) {
+					write(event.type);
+					write(event.nameId);
+					write(buffer->threadIndex);
+					write(event.time);
+					write(event.value);
+					if (event.type == format::RecordType::SCOPE) {
+						write(event.allocations);
+						write(event.allocatedBytes);
+					}
+				}
+			}
+			m_outFile.flush();
+		}
+		template <class T>
+		void write(const T& value) {
+			m_outFile.write(reinterpret_cast<const char*>(&value), sizeof(T));
 		}
 	};
 
 
 	// InstrumentationTimer
 	// RAII style
+	// Costs one relaxed load while the profiler is disabled
 	class InstrumentationTimer {
 	private:
-		long long m_startTime;
-		std::string_view m_name;
+		bool m_active;
+		uint32_t m_nameId;
+		int64_t m_startTime{ 0 };
+		uint64_t m_startAllocations{ 0 };
+		uint64_t m_startAllocatedBytes{ 0 };
 	public:
-		InstrumentationTimer(std::string_view name)
-			: m_startTime(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count()), m_name(name) {
-			// Fix start time
-			static long long lastStartTime = 0;
-			if (lastStartTime == m_startTime)
-				++m_startTime;
-			lastStartTime = m_startTime;
+		InstrumentationTimer(uint32_t nameId)
+			: m_active(Profiler::isEnabled()), m_nameId(nameId) {
+			if (m_active) {
+				m_startAllocations = detail::allocations;
+				m_startAllocatedBytes = detail::allocatedBytes;
+				m_startTime = Profiler::instance().now();
+			}
 		}
 		~InstrumentationTimer() {
-			// Get endtime in microseconds
-			auto endTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-			// Get Thread id
-			auto threadID = std::hash<std::thread::id>()(std::this_thread::get_id());
-
-			// Process Trace
-			Profiler::processTrace(m_name, endTime - m_startTime, m_startTime, threadID);
+			if (!m_active)
+				return;
+			auto& profiler = Profiler::instance();
+			profiler.record(TraceEvent{ m_nameId, format::RecordType::SCOPE, m_startTime, profiler.now() - m_startTime,
+				detail::allocations - m_startAllocations, detail::allocatedBytes - m_startAllocatedBytes });
 		}
 	};
 }
 
 
 // Define macros for profiling
-// Set PROFILE to 1 if you want to profile your code
-// Set it to 0 otherwise
-#define PROFILE 0
+// Set PROFILE to 0 to compile the instrumentation out
+// Otherwise it is recorded only while prof::Profiler::setEnabled(true)
+// Set PROFILE_ALLOCATIONS to 1 to count the heap allocations made inside each scope, it replaces the global operator new
+#define PROFILE 1
+#define PROFILE_ALLOCATIONS 0
 #if PROFILE
-#define PROFILE_SCOPE(name) prof::InstrumentationTimer tracer##__LINE__(name)
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+// The name is registered once per scope, the first time the scope runs
+#define PROFILE_SCOPE(name) \
+	static const uint32_t PROFILE_CONCAT(profileName, __LINE__) = prof::Profiler::registerName(name); \
+	prof::InstrumentationTimer PROFILE_CONCAT(tracer, __LINE__)(PROFILE_CONCAT(profileName, __LINE__))
+// Record a value on a named counter track
+#define PROFILE_COUNTER(name, value) \
+	do { \
+		static const uint32_t profileCounterName = prof::Profiler::registerName(name); \
+		if (prof::Profiler::isEnabled()) \
+			prof::Profiler::instance().recordCounter(profileCounterName, static_cast<int64_t>(value)); \
+	} while (false)
 #else
 #define PROFILE_SCOPE(name)
+#define PROFILE_COUNTER(name, value)
 #endif
 #define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
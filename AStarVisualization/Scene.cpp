@@ -4,3 +4,6 @@ std::shared_ptr<EntityManager> Scene::getManager() {
 	return m_entityManager;
 }
 
+DirtyRegion& Scene::getDirtyRegion() {
+	return m_dirtyRegion;
+}
@@ -1,12 +1,15 @@
 #pragma once
 #include "EntityManager.hpp"
 #include "Config.hpp"
+#include "DirtyRegion.hpp"
 
 class Scene
 {
 protected:
 	std::shared_ptr<EntityManager> m_entityManager;
 	GameConfig& m_config;
+	// Areas to redraw in the next render
+	DirtyRegion m_dirtyRegion;
 public:
 	virtual ~Scene() = default;
 	Scene() : m_entityManager(std::make_shared<EntityManager>()), m_config(GameConfig::instance()) {}
@@ -14,6 +17,12 @@ public:
 	virtual void handleMouseInput(sf::Event& event) = 0;
 	virtual void handleKeyBoardInput(sf::Event& event) = 0;
 	virtual void update(sf::RenderWindow& window) {}
-	virtual bool getNeedRender() = 0;
+	// True while the scene changes without user input, e.g. an animation
+	// Otherwise the game loop sleeps until the next window event once the dirty regions are drawn.
+	virtual bool isAnimating() { return false; }
+	// Draw what the scene renders outside of the entities, called before the entities are drawn
+	// Only the part inside region has to be drawn, the rest is clipped.
+	virtual void draw(sf::RenderTarget& target, const sf::FloatRect& region) {}
 	std::shared_ptr<EntityManager> getManager();
+	DirtyRegion& getDirtyRegion();
 };
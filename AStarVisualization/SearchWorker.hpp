@@ -0,0 +1,278 @@
+#pragma once
+#include "AStarSearch.hpp"
+#include "SpscQueue.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+// Runs A* searches on a background thread
+// The worker owns the graph given to setGraph, once per map, and keeps its search state in it.
+// A submitted search only carries a snapshot of the obstacle state, so the UI thread may keep editing the map. Visit events are published through a lock-free SPSC channel
+// and applied by poll on the UI thread. While the channel is full the search keeps running and its events are
+// merged into an overflow buffer that holds the latest state of each vertex, so the search never waits for the UI
+// until its final events. Submitting a new search or calling cancel abandons the running one,
+// the worker checks for it between slices of ExpansionsPerSlice expansions and while it waits for the channel.
+template <class Vertex>
+class SearchWorker
+{
+public:
+	using Heuristic = typename AStarSearch<Vertex>::Heuristic;
+	static constexpr size_t ExpansionsPerSlice = 256;
+	// Number of events applied between two clock reads in poll
+	static constexpr size_t ClockInterval = 256;
+
+	explicit SearchWorker(size_t channelCapacity = size_t(1) << 16);
+	SearchWorker(const SearchWorker&) = delete;
+	SearchWorker& operator=(const SearchWorker&) = delete;
+	~SearchWorker();
+	void setGraph(AdjacencyListGraph<Vertex> graph);
+	void submit(std::vector<uint8_t> obstacles, size_t from, size_t to, Heuristic heuristic);
+	void cancel();
+	bool isRunning() const;
+	const AStarStats& getStats() const;
+	const typename AStarSearch<Vertex>::Path& getPath() const;
+	template <class OnVisit>
+	void poll(OnVisit&& onVisit, std::chrono::nanoseconds timeBudget);
+private:
+	struct Job {
+		uint32_t id;
+		std::vector<uint8_t> obstacles;
+		size_t from, to;
+		Heuristic heuristic;
+	};
+	struct Event {
+		uint32_t job{ 0 };
+		bool done{ false };
+		VisitState state{ VisitState::OPENED };
+		size_t vertex{ 0 };
+	};
+	SpscQueue<Event> m_channel;
+	// Id of the search the UI is waiting for, any other search is cancelled
+	std::atomic<uint32_t> m_currentJob{ 0 };
+	bool m_running{ false };
+	// Stats and path of the last search polled to completion, and of the last search the worker finished
+	AStarStats m_stats;
+	AStarStats m_finishedStats;
+	typename AStarSearch<Vertex>::Path m_path;
+	typename AStarSearch<Vertex>::Path m_finishedPath;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::optional<Job> m_pending;
+	std::optional<AdjacencyListGraph<Vertex>> m_pendingGraph;
+	// Signalled by poll and cancel while the worker waits for space in the channel
+	std::mutex m_spaceMutex;
+	std::condition_variable m_space;
+	std::atomic<bool> m_waitingForSpace{ false };
+	// Only used by the worker thread
+	AdjacencyListGraph<Vertex> m_graph{ 0 };
+	// Events that did not fit into the channel, from m_overflowBegin on, at most one per vertex
+	std::vector<Event> m_overflow;
+	size_t m_overflowBegin{ 0 };
+	// 1 + index in m_overflow of the queued event of each vertex, 0 if it has none
+	std::vector<size_t> m_overflowSlots;
+	bool m_stop{ false };
+	std::thread m_thread;
+	void run();
+	void runJob(Job& job);
+	bool isCancelled(uint32_t job) const;
+	void publish(const Event& event);
+	bool flushOverflow();
+	void waitForOverflow(uint32_t job);
+};
+
+template <class Vertex>
+SearchWorker<Vertex>::SearchWorker(size_t channelCapacity)
+	: m_channel(channelCapacity), m_thread([this]() { run(); }) {}
+
+template <class Vertex>
+SearchWorker<Vertex>::~SearchWorker() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	cancel();
+	m_condition.notify_one();
+	m_thread.join();
+}
+
+// Start a search, the previous search is cancelled
+template <class Vertex>
+void SearchWorker<Vertex>::submit(std::vector<uint8_t> obstacles, size_t from, size_t to, Heuristic heuristic) {
+	uint32_t id = m_currentJob.fetch_add(1, std::memory_order_acq_rel) + 1;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending.emplace(Job{ id, std::move(obstacles), from, to, std::move(heuristic) });
+	}
+	m_running = true;
+	m_condition.notify_one();
+}
+
+// Replace the graph of the next searches, the running and the pending search are cancelled
+// The worker takes it over before its next search, the UI thread does not copy it again.
+template <class Vertex>
+void SearchWorker<Vertex>::setGraph(AdjacencyListGraph<Vertex> graph) {
+	cancel();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_pending.reset();
+	m_pendingGraph.emplace(std::move(graph));
+}
+
+// Abandon the running search, its pending events are dropped
+template <class Vertex>
+void SearchWorker<Vertex>::cancel() {
+	m_currentJob.fetch_add(1, std::memory_order_acq_rel);
+	m_running = false;
+	std::lock_guard<std::mutex> lock(m_spaceMutex);
+	m_space.notify_one();
+}
+
+// True until the final event of the current search has been polled
+template <class Vertex>
+bool SearchWorker<Vertex>::isRunning() const {
+	return m_running;
+}
+
+// Stats of the last completed search, valid once isRunning returns false after a poll
+template <class Vertex>
+const AStarStats& SearchWorker<Vertex>::getStats() const {
+	return m_stats;
+}
+
+// Path of the last completed search, valid like getStats
+template <class Vertex>
+const typename AStarSearch<Vertex>::Path& SearchWorker<Vertex>::getPath() const {
+	return m_path;
+}
+
+// Apply the published events of the current search with onVisit(vertex, state) on the calling thread
+// Stops when the channel is empty or timeBudget has passed, the rest is applied by the next poll.
+template <class Vertex>
+template <class OnVisit>
+void SearchWorker<Vertex>::poll(OnVisit&& onVisit, std::chrono::nanoseconds timeBudget) {
+	using Clock = std::chrono::steady_clock;
+	auto deadline = Clock::now() + timeBudget;
+	uint32_t current = m_currentJob.load(std::memory_order_relaxed);
+	Event event;
+	size_t count = 0;
+	while (m_channel.tryPop(event)) {
+		if (event.job == current) {
+			if (event.done) {
+				m_running = false;
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stats = m_finishedStats;
+				m_path = m_finishedPath;
+			}
+			else
+				onVisit(event.vertex, event.state);
+		}
+		if (++count % ClockInterval == 0 && Clock::now() >= deadline)
+			break;
+	}
+	if (count != 0 && m_waitingForSpace.load()) {
+		std::lock_guard<std::mutex> lock(m_spaceMutex);
+		m_space.notify_one();
+	}
+}
+
+template <class Vertex>
+void SearchWorker<Vertex>::run() {
+	while (true) {
+		std::optional<Job> job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_stop || m_pending; });
+			if (m_stop)
+				return;
+			job.swap(m_pending);
+			if (m_pendingGraph) {
+				m_graph = std::move(*m_pendingGraph);
+				m_pendingGraph.reset();
+			}
+		}
+		runJob(*job);
+	}
+}
+
+template <class Vertex>
+void SearchWorker<Vertex>::runJob(Job& job) {
+	auto isBlocked = [&job](size_t vertex) {
+		return job.obstacles[vertex] != 0;
+	};
+	auto onVisit = [this, &job](size_t vertex, VisitState state) {
+		publish(Event{ job.id, false, state, vertex });
+	};
+	m_overflow.clear();
+	m_overflowBegin = 0;
+	m_overflowSlots.assign(m_graph.getNumVertices(), 0);
+	AStarSearch<Vertex, decltype(isBlocked), decltype(onVisit)> search(m_graph, job.from, job.to,
+		job.heuristic, isBlocked, onVisit);
+	while (!search.step(ExpansionsPerSlice)) {
+		if (isCancelled(job.id))
+			return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_finishedStats = search.getStats();
+		m_finishedPath = search.getPath();
+	}
+	// The done event queues behind the overflowed visit events, the UI must receive all of them
+	publish(Event{ job.id, true });
+	waitForOverflow(job.id);
+}
+
+template <class Vertex>
+bool SearchWorker<Vertex>::isCancelled(uint32_t job) const {
+	return m_currentJob.load(std::memory_order_acquire) != job;
+}
+
+// Push the event into the channel, or merge it into the overflow if the channel is full
+template <class Vertex>
+void SearchWorker<Vertex>::publish(const Event& event) {
+	if (flushOverflow() && m_channel.tryPush(event))
+		return;
+	if (!event.done) {
+		size_t& slot = m_overflowSlots[event.vertex];
+		// A later state of the same vertex replaces the queued one
+		if (slot != 0) {
+			m_overflow[slot - 1].state = event.state;
+			return;
+		}
+		slot = m_overflow.size() + 1;
+	}
+	m_overflow.push_back(event);
+}
+
+// Move overflowed events into the channel while it has space, returns true once the overflow is empty
+template <class Vertex>
+bool SearchWorker<Vertex>::flushOverflow() {
+	while (m_overflowBegin < m_overflow.size()) {
+		const Event& event = m_overflow[m_overflowBegin];
+		if (!m_channel.tryPush(event))
+			return false;
+		if (!event.done)
+			m_overflowSlots[event.vertex] = 0;
+		++m_overflowBegin;
+	}
+	m_overflow.clear();
+	m_overflowBegin = 0;
+	return true;
+}
+
+// Block until the overflow is in the channel, gives up if the search was cancelled meanwhile
+template <class Vertex>
+void SearchWorker<Vertex>::waitForOverflow(uint32_t job) {
+	m_waitingForSpace = true;
+	while (!flushOverflow()) {
+		if (isCancelled(job))
+			break;
+		// poll and cancel signal, the timeout covers a signal sent between the check and the wait
+		std::unique_lock<std::mutex> lock(m_spaceMutex);
+		m_space.wait_for(lock, std::chrono::milliseconds(5));
+	}
+	m_waitingForSpace = false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread
+// The producer only writes m_tail and the consumer only writes m_head,
+// the release/acquire pairs on them publish the slots between the threads.
+template <class T>
+class SpscQueue
+{
+	static constexpr size_t CacheLine = 64;
+	std::vector<T> m_buffer;
+	size_t m_mask;
+	// Next slot to read, written by the consumer
+	alignas(CacheLine) std::atomic<size_t> m_head{ 0 };
+	// Next slot to write, written by the producer
+	alignas(CacheLine) std::atomic<size_t> m_tail{ 0 };
+public:
+	explicit SpscQueue(size_t capacity);
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+	bool tryPush(const T& value);
+	bool tryPop(T& value);
+	size_t capacity() const;
+};
+
+// The capacity is rounded up to a power of two
+template <class T>
+SpscQueue<T>::SpscQueue(size_t capacity) {
+	size_t size = 1;
+	while (size < capacity)
+		size <<= 1;
+	m_buffer.resize(size);
+	m_mask = size - 1;
+}
+
+// Producer only, returns false if the queue is full
+template <class T>
+bool SpscQueue<T>::tryPush(const T& value) {
+	size_t tail = m_tail.load(std::memory_order_relaxed);
+	if (tail - m_head.load(std::memory_order_acquire) == m_buffer.size())
+		return false;
+	m_buffer[tail & m_mask] = value;
+	m_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+// Consumer only, returns false if the queue is empty
+template <class T>
+bool SpscQueue<T>::tryPop(T& value) {
+	size_t head = m_head.load(std::memory_order_relaxed);
+	if (head == m_tail.load(std::memory_order_acquire))
+		return false;
+	value = m_buffer[head & m_mask];
+	m_head.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+template <class T>
+size_t SpscQueue<T>::capacity() const {
+	return m_buffer.size();
+}
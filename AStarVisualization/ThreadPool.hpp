@@ -0,0 +1,121 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+// Fixed set of worker threads that run parallel loops
+// The threads are created once and sleep between loops, so a loop costs a wake up instead of a thread start.
+// The calling thread takes part in the loop. A loop started from inside a task, or while another thread
+// runs a loop on the same pool, is run by the calling thread alone.
+class ThreadPool
+{
+public:
+	explicit ThreadPool(size_t numWorkers);
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool();
+	static ThreadPool& getShared();
+	void parallelFor(size_t count, const std::function<void(size_t)>& task);
+	size_t getNumThreads() const;
+private:
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	// Serializes the loops, the owner runs the current loop
+	std::mutex m_loopMutex;
+	const std::function<void(size_t)>* m_task{ nullptr };
+	size_t m_count{ 0 };
+	std::atomic<size_t> m_next{ 0 };
+	size_t m_busyWorkers{ 0 };
+	uint64_t m_generation{ 0 };
+	bool m_stop{ false };
+	static bool& isInTask();
+	void run();
+	void work();
+};
+
+inline ThreadPool::ThreadPool(size_t numWorkers) {
+	m_workers.reserve(numWorkers);
+	for (size_t i = 0; i < numWorkers; ++i)
+		m_workers.emplace_back(&ThreadPool::run, this);
+}
+
+inline ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (auto& worker : m_workers)
+		worker.join();
+}
+
+// Pool with one thread per hardware thread, counting the caller, created on first use
+inline ThreadPool& ThreadPool::getShared() {
+	static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+	return pool;
+}
+
+// Run task(i) for every i in [0, count) and return once all of them are done
+inline void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& task) {
+	std::unique_lock<std::mutex> loopLock(m_loopMutex, std::defer_lock);
+	if (count <= 1 || m_workers.empty() || isInTask() || !loopLock.try_lock()) {
+		for (size_t i = 0; i < count; ++i)
+			task(i);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = &task;
+		m_count = count;
+		m_next = 0;
+		m_busyWorkers = m_workers.size();
+		++m_generation;
+	}
+	m_wake.notify_all();
+	work();
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this]() { return m_busyWorkers == 0; });
+	m_task = nullptr;
+}
+
+// Number of threads that run a loop, counting the caller
+inline size_t ThreadPool::getNumThreads() const {
+	return m_workers.size() + 1;
+}
+
+inline bool& ThreadPool::isInTask() {
+	thread_local bool inTask = false;
+	return inTask;
+}
+
+inline void ThreadPool::run() {
+	uint64_t generation = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this, generation]() { return m_stop || m_generation != generation; });
+			if (m_stop)
+				return;
+			generation = m_generation;
+		}
+		work();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_busyWorkers == 0)
+			m_done.notify_one();
+	}
+}
+
+// Take indices of the current loop until none are left
+inline void ThreadPool::work() {
+	isInTask() = true;
+	for (size_t i = m_next++; i < m_count; i = m_next++)
+		(*m_task)(i);
+	isInTask() = false;
+}
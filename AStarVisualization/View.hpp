@@ -0,0 +1,65 @@
+#pragma once
+#include "Entity.hpp"
+#include <deque>
+#include <array>
+#include <tuple>
+#include <type_traits>
+
+// Iterates the entities that have every component in Ts
+// The smallest pool drives the iteration and only its entities are checked against the other pools.
+// The view sees the components, not the registration of the EntityManager,
+// so entities added or destroyed since the last update are visited too.
+// Components must not be added or removed while iterating, destroying entities is fine.
+template <class... Ts>
+class View
+{
+	std::tuple<ComponentPool<Ts>*...> m_pools;
+	std::deque<Entity>* m_slots;
+	const std::vector<size_t>& getDrivingIds(const void*& driver) const;
+public:
+	View(std::deque<Entity>& slots, ComponentPool<Ts>&... pools);
+	template <class Func> void each(Func&& func);
+};
+
+template <class... Ts>
+View<Ts...>::View(std::deque<Entity>& slots, ComponentPool<Ts>&... pools)
+	: m_pools(&pools...), m_slots(&slots) {}
+
+// Entity ids of the smallest pool, the pool is stored in driver
+// The view iterates these ids, so its cost follows the rarest component
+template <class... Ts>
+const std::vector<size_t>& View<Ts...>::getDrivingIds(const void*& driver) const {
+	std::array<const void*, sizeof...(Ts)> pools;
+	std::array<const std::vector<size_t>*, sizeof...(Ts)> ids;
+	std::apply([&](auto*... componentPools) {
+		pools = { componentPools... };
+		ids = { &componentPools->getEntityIds()... };
+		}, m_pools);
+	size_t smallest = 0;
+	for (size_t i = 1; i < ids.size(); ++i) {
+		if (ids[i]->size() < ids[smallest]->size())
+			smallest = i;
+	}
+	driver = pools[smallest];
+	return *ids[smallest];
+}
+
+// Calls func(components...) or func(entity, components...) for every matching entity
+// The ids of the driving pool are only checked against the other pools
+template <class... Ts>
+template <class Func>
+void View<Ts...>::each(Func&& func) {
+	const void* driver = nullptr;
+	for (size_t id : getDrivingIds(driver)) {
+		if constexpr (sizeof...(Ts) > 1) {
+			if (!std::apply([id, driver](auto*... pools) { return ((pools == driver || pools->contains(id)) && ...); }, m_pools))
+				continue;
+		}
+		std::apply([&](auto*... pools) {
+			if constexpr (std::is_invocable_v<Func, Entity&, Ts&...>)
+				func((*m_slots)[id], *pools->get(id)...);
+			else
+				func(*pools->get(id)...);
+			}, m_pools);
+	}
+}
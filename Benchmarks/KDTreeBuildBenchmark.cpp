@@ -0,0 +1,63 @@
+#include "KDTree.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures KDTree::buildTree on a grid of points with thread pools of increasing size
+// The result is checked by nearest neighbor queries once per pool size
+// Usage: KDTreeBuildBenchmark [gridSide=4000] [repetitions=3]
+int main(int argc, char* argv[]) {
+	size_t side = argc > 1 ? std::stoul(argv[1]) : 4000;
+	size_t repetitions = argc > 2 ? std::stoul(argv[2]) : 3;
+
+	// Cell centers of a side x side grid, shuffled so the build does not start from sorted input
+	std::vector<std::pair<std::array<float, 2>, size_t>> pairs;
+	pairs.reserve(side * side);
+	for (size_t i = 0; i < side; ++i) {
+		for (size_t j = 0; j < side; ++j)
+			pairs.push_back({ { j + 0.5f, i + 0.5f }, j + side * i });
+	}
+	std::shuffle(pairs.begin(), pairs.end(), std::mt19937(42));
+
+	// Powers of two, and always the hardware thread count
+	size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<size_t> threadCounts;
+	for (size_t threads = 1; threads < maxThreads; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(maxThreads);
+
+	double baseline = 0;
+	std::mt19937 random(7);
+	std::uniform_int_distribution<size_t> cellDistribution(0, side * side - 1);
+	std::cout << "points: " << pairs.size() << "\n";
+	std::cout << "threads\tbest ms\tspeedup\n";
+	for (size_t threads : threadCounts) {
+		double best = std::numeric_limits<double>::max();
+		// The caller is one of the threads of the pool
+		ThreadPool pool(threads - 1);
+		KDTree<2, size_t> tree;
+		for (size_t r = 0; r < repetitions; ++r) {
+			auto start = std::chrono::steady_clock::now();
+			tree.buildTree(pairs, pool);
+			auto end = std::chrono::steady_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		// A point near a cell center must find that cell
+		for (size_t q = 0; q < 1000; ++q) {
+			size_t cell = cellDistribution(random);
+			float x = cell % side + 0.75f, y = cell / side + 0.75f;
+			if (tree.findNearestNeighbor({ x, y }).second != cell) {
+				std::cerr << "wrong nearest neighbor of cell " << cell << " with " << threads << " threads\n";
+				return 2;
+			}
+		}
+		if (threads == 1)
+			baseline = best;
+		std::cout << threads << "\t" << best << "\t" << baseline / best << "\n";
+	}
+	return 0;
+}
@@ -0,0 +1,119 @@
+#include "DynamicKDTree.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Grows a tree by random insertions and erasures mixed with nearest neighbor, k nearest and range queries,
+// checks sampled answers against a linear scan of the live points and prints the mean cost of each operation
+// every time the tree doubles in size. Exits with 2 if a query returned a wrong answer.
+// Usage: KDTreeUpdateBenchmark [operations=400000]
+
+using Point = std::array<float, 2>;
+using PointDataPair = std::pair<Point, size_t>;
+
+float getSquaredDistance(const Point& a, const Point& b) {
+	float dx = a[0] - b[0], dy = a[1] - b[1];
+	return dx * dx + dy * dy;
+}
+
+// Squared distances of the k nearest live points, closest first
+std::vector<float> getNearestDistances(const std::vector<PointDataPair>& live, const Point& target, size_t k) {
+	std::vector<float> distances;
+	distances.reserve(live.size());
+	for (auto& pair : live)
+		distances.push_back(getSquaredDistance(pair.first, target));
+	k = std::min(k, distances.size());
+	std::partial_sort(distances.begin(), distances.begin() + k, distances.end());
+	distances.resize(k);
+	return distances;
+}
+
+size_t countInRange(const std::vector<PointDataPair>& live, const Point& lower, const Point& upper) {
+	size_t count = 0;
+	for (auto& pair : live) {
+		if (pair.first[0] >= lower[0] && pair.first[0] <= upper[0] && pair.first[1] >= lower[1] && pair.first[1] <= upper[1])
+			++count;
+	}
+	return count;
+}
+
+template <class Tree>
+size_t run(const char* name, size_t operations) {
+	using Clock = std::chrono::steady_clock;
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> coordinate(0, 1000);
+	Tree tree;
+	std::vector<PointDataPair> live;
+	size_t nextId = 0, mismatches = 0, reportSize = 1024;
+	// Time and count of the inserts, erases and queries since the last report
+	double seconds[3] = {};
+	size_t counts[3] = {};
+	std::cout << name << "\nsize\tinsert us\terase us\tquery us\n";
+	for (size_t operation = 0; operation < operations; ++operation) {
+		size_t kind = rng() % 10;
+		Clock::time_point start;
+		if (kind < 5 || live.empty()) {
+			PointDataPair pair{ { coordinate(rng), coordinate(rng) }, nextId++ };
+			start = Clock::now();
+			tree.insert(pair);
+			seconds[0] += std::chrono::duration<double>(Clock::now() - start).count();
+			++counts[0];
+			live.push_back(pair);
+		}
+		else if (kind < 7) {
+			size_t index = rng() % live.size();
+			start = Clock::now();
+			bool erased = tree.erase(live[index].first, live[index].second);
+			seconds[1] += std::chrono::duration<double>(Clock::now() - start).count();
+			++counts[1];
+			if (!erased)
+				++mismatches;
+			live[index] = live.back();
+			live.pop_back();
+		}
+		else {
+			Point target{ coordinate(rng), coordinate(rng) };
+			Point lower{ target[0] - 20, target[1] - 20 }, upper{ target[0] + 20, target[1] + 20 };
+			start = Clock::now();
+			auto nearest = tree.findNearestNeighbor(target);
+			auto kNearest = tree.kNearest(target, 5);
+			auto range = tree.searchRange(lower, upper);
+			seconds[2] += std::chrono::duration<double>(Clock::now() - start).count();
+			++counts[2];
+			// The linear scans are slow, check one query in 64
+			if (counts[2] % 64 == 0) {
+				auto expected = getNearestDistances(live, target, 5);
+				bool correct = getSquaredDistance(nearest.first, target) == expected[0] && kNearest.size() == expected.size()
+					&& range.size() == countInRange(live, lower, upper);
+				for (size_t i = 0; correct && i < kNearest.size(); ++i)
+					correct = getSquaredDistance(kNearest[i].first, target) == expected[i];
+				if (!correct)
+					++mismatches;
+			}
+		}
+		if (live.size() == reportSize || operation + 1 == operations) {
+			char line[128];
+			std::snprintf(line, sizeof(line), "%zu\t%.3f\t%.3f\t%.3f\n", live.size(),
+				seconds[0] * 1e6 / std::max<size_t>(counts[0], 1), seconds[1] * 1e6 / std::max<size_t>(counts[1], 1),
+				seconds[2] * 1e6 / std::max<size_t>(counts[2], 1));
+			std::cout << line;
+			reportSize *= 2;
+			std::fill(std::begin(seconds), std::end(seconds), 0.0);
+			std::fill(std::begin(counts), std::end(counts), size_t(0));
+		}
+	}
+	if (tree.size() != live.size())
+		++mismatches;
+	std::cout << mismatches << " mismatches\n";
+	return mismatches;
+}
+
+int main(int argc, char* argv[]) {
+	size_t operations = argc > 1 ? std::stoul(argv[1]) : 400000;
+	size_t mismatches = run<DynamicKDTree<2, size_t>>("DynamicKDTree", operations);
+	return mismatches == 0 ? 0 : 2;
+}
@@ -0,0 +1,126 @@
+#include "AStar.hpp"
+#include "GridMap.hpp"
+#include "PathCache.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Repeats queries between a few hot cells of a random map while painting and erasing obstacles,
+// checks every path the PathCache returns against a fresh search and compares their latencies.
+// Runs on 4 connected and on 8 connected grids, exits with 2 if the cache returned a wrong path.
+// Usage: PathCacheBenchmark [gridSide=96] [operations=5000]
+
+struct Vertex {
+	std::pair<float, float> pos;
+	float gScore, fScore;
+	size_t parent;
+};
+
+float getCost(const PathCache::Path& path) {
+	return path.empty() ? std::numeric_limits<float>::infinity() : path.back().second - path.front().second;
+}
+
+PathCache::Path search(const GridMap& map, bool diagonal, size_t from, size_t to) {
+	auto graph = map.buildGraph<Vertex>(diagonal);
+	return AStar<Vertex>::shortestPath(graph, from, to);
+}
+
+// A cached path is correct if it connects the cells through free cells at the optimal cost
+bool isCorrect(const GridMap& map, const PathCache::Path& path, size_t from, size_t to, float optimal) {
+	if (path.empty() || path.front().first != from || path.back().first != to)
+		return false;
+	for (auto& step : path) {
+		if (map.isBlocked(step.first))
+			return false;
+	}
+	return std::abs(getCost(path) - optimal) <= 1e-4f * optimal + 1e-3f;
+}
+
+// Freeing a cell must evict the paths the diagonal moves around its corners shorten
+size_t checkFreedCorner() {
+	GridMap map(2, 2);
+	map.setBlocked(1, true);
+	PathCache cache(2, 2, true);
+	cache.insert(0, 3, 0, search(map, true, 0, 3));
+	map.setBlocked(1, false);
+	cache.invalidate({ 1 }, false, 1);
+	auto cached = cache.find(0, 3, 1);
+	return cached && !isCorrect(map, *cached, 0, 3, getCost(search(map, true, 0, 3))) ? 1 : 0;
+}
+
+size_t run(size_t side, size_t operations, bool diagonal) {
+	std::mt19937 rng(diagonal ? 7 : 3);
+	GridMap map(side, side);
+	for (size_t cell = 0; cell < side * side; ++cell)
+		map.setBlocked(cell, rng() % 100 < 25);
+	std::vector<size_t> hotCells(12);
+	for (auto& cell : hotCells)
+		cell = rng() % (side * side);
+
+	PathCache cache(side, side, diagonal, 256);
+	uint64_t version = 0;
+	size_t queries = 0, edits = 0, mismatches = 0;
+	double cachedSeconds = 0, searchSeconds = 0;
+	size_t searches = 0;
+	using Clock = std::chrono::steady_clock;
+	for (size_t operation = 0; operation < operations; ++operation) {
+		// Paint or erase a small square
+		if (rng() % 8 == 0) {
+			std::vector<size_t> cells;
+			size_t x = rng() % side, y = rng() % side, radius = rng() % 3;
+			bool blocked = rng() % 2 == 0;
+			for (size_t cy = y - std::min(y, radius); cy <= std::min(side - 1, y + radius); ++cy) {
+				for (size_t cx = x - std::min(x, radius); cx <= std::min(side - 1, x + radius); ++cx) {
+					size_t cell = map.getCell(cx, cy);
+					if (map.isBlocked(cell) != blocked) {
+						map.setBlocked(cell, blocked);
+						cells.push_back(cell);
+					}
+				}
+			}
+			if (!cells.empty()) {
+				cache.invalidate(cells, blocked, ++version);
+				++edits;
+			}
+			continue;
+		}
+		size_t from = hotCells[rng() % hotCells.size()], to = hotCells[rng() % hotCells.size()];
+		if (map.isBlocked(from) || map.isBlocked(to))
+			continue;
+		++queries;
+		auto start = Clock::now();
+		auto cached = cache.find(from, to, version);
+		if (cached) {
+			cachedSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+			if (!isCorrect(map, *cached, from, to, getCost(search(map, diagonal, from, to))))
+				++mismatches;
+			continue;
+		}
+		start = Clock::now();
+		auto path = search(map, diagonal, from, to);
+		searchSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+		++searches;
+		cache.insert(from, to, version, path);
+	}
+	size_t hits = cache.getHits() + cache.getSubpathHits();
+	std::cout << (diagonal ? "8 connected" : "4 connected") << ": " << queries << " queries, " << edits << " edits, "
+		<< cache.getHits() << " hits, " << cache.getSubpathHits() << " subpath hits, " << cache.getMisses() << " misses, "
+		<< mismatches << " mismatches\n";
+	std::cout << "  mean cached query " << (hits ? cachedSeconds * 1e6 / hits : 0) << " us, mean search (with graph build) "
+		<< (searches ? searchSeconds * 1e6 / searches : 0) << " us\n";
+	return mismatches;
+}
+
+int main(int argc, char* argv[]) {
+	size_t side = argc > 1 ? std::stoul(argv[1]) : 96;
+	size_t operations = argc > 2 ? std::stoul(argv[2]) : 5000;
+	size_t mismatches = checkFreedCorner();
+	if (mismatches)
+		std::cout << "freed corner: stale path returned\n";
+	mismatches += run(side, operations, false);
+	mismatches += run(side, operations, true);
+	return mismatches == 0 ? 0 : 2;
+}
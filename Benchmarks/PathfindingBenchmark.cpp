@@ -0,0 +1,240 @@
+#include "AStar.hpp"
+#include "GridMap.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+// Runs the MovingAI scenarios (*.scen) of a directory through every search mode, checks the costs
+// against the optimal lengths of the scenarios and prints the results as JSON.
+// Moves are octile without corner cutting, the rules of the MovingAI scenarios.
+// Each run reports the memory of its searches, the graph with the per-vertex search state and the peak open list,
+// the peak resident memory of the whole process is reported once.
+// Usage: PathfindingBenchmark [directory=Benchmarks/maps] [--repeat N] [--output file]
+
+struct Vertex {
+	std::pair<float, float> pos;
+	float gScore, fScore;
+	size_t parent;
+};
+
+struct Scenario {
+	size_t from, to;
+	double optimalLength;
+};
+
+// A way to answer a query, exact modes must return the optimal length
+struct Mode {
+	const char* name;
+	bool exact;
+	std::vector<std::pair<size_t, float>>(*run)(AdjacencyListGraph<Vertex>& graph, size_t from, size_t to, AStarStats& stats);
+};
+
+float octile(const std::pair<float, float>& posA, const std::pair<float, float>& posB) {
+	float dy = std::abs(posA.first - posB.first), dx = std::abs(posA.second - posB.second);
+	return std::max(dx, dy) + (std::sqrt(2.f) - 1) * std::min(dx, dy);
+}
+
+auto isBlocked = [](size_t) { return false; };
+auto onVisit = [](size_t, VisitState) {};
+
+const Mode modes[] = {
+	{ "astar", true, [](AdjacencyListGraph<Vertex>& graph, size_t from, size_t to, AStarStats& stats) {
+		return AStar<Vertex>::shortestPath(graph, from, to, octile, isBlocked, onVisit, &stats);
+	} },
+	// Compiled without stats collection, its counters stay 0, compare its latency with astar
+	{ "astar_no_stats", true, [](AdjacencyListGraph<Vertex>& graph, size_t from, size_t to, AStarStats&) {
+		return AStar<Vertex>::shortestPath(graph, from, to, octile, isBlocked, onVisit);
+	} },
+	{ "dijkstra", true, [](AdjacencyListGraph<Vertex>& graph, size_t from, size_t to, AStarStats& stats) {
+		return AStar<Vertex>::shortestPath(graph, from, to,
+			[](const std::pair<float, float>&, const std::pair<float, float>&) { return 0.f; }, isBlocked, onVisit, &stats);
+	} },
+	// Resumed every 256 expansions like the searches of the visualization
+	{ "astar_stepped", true, [](AdjacencyListGraph<Vertex>& graph, size_t from, size_t to, AStarStats& stats) {
+		AStarSearch<Vertex, decltype(isBlocked), decltype(onVisit)> search(graph, from, to, octile, isBlocked, onVisit);
+		while (!search.step(256));
+		stats = search.getStats();
+		return search.getPath();
+	} },
+	// Inadmissible, reports how far from optimal it gets
+	{ "weighted_astar_1.5", false, [](AdjacencyListGraph<Vertex>& graph, size_t from, size_t to, AStarStats& stats) {
+		return AStar<Vertex>::shortestPath(graph, from, to,
+			[](const std::pair<float, float>& posA, const std::pair<float, float>& posB) { return 1.5f * octile(posA, posB); },
+			isBlocked, onVisit, &stats);
+	} },
+};
+
+// Peak resident memory of the process in kilobytes
+size_t getPeakMemoryKB() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.PeakWorkingSetSize / 1024;
+	return 0;
+#else
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// Bytes of the graph and of the per-vertex state of one search over it, the open list is not included
+size_t getSearchBytes(AdjacencyListGraph<Vertex>& graph) {
+	size_t numVertices = graph.getNumVertices();
+	size_t bytes = sizeof(graph) + numVertices * (sizeof(Vertex) + 2 * sizeof(std::vector<size_t>));
+	for (size_t vertex = 0; vertex < numVertices; ++vertex)
+		bytes += graph.getAdjacent(vertex).capacity() * sizeof(size_t) + graph.getEdgeAttributes(vertex).capacity() * sizeof(float);
+	// The closed set is a bit vector, the open list handles one pointer per vertex
+	return bytes + numVertices / 8 + numVertices * sizeof(FibonacciHeap<size_t>::Handle);
+}
+
+// Read a scenario file, its map is loaded from the same directory and its file name is stored in mapName
+std::vector<Scenario> loadScenarios(const std::filesystem::path& path, GridMap& map, std::string& mapName) {
+	std::ifstream in(path);
+	if (!in)
+		throw std::runtime_error("Can not open " + path.string());
+	std::vector<Scenario> scenarios;
+	std::string line;
+	mapName.clear();
+	while (std::getline(in, line)) {
+		std::istringstream fields(line);
+		size_t bucket, width, height, startX, startY, goalX, goalY;
+		std::string name;
+		double optimalLength;
+		if (!(fields >> bucket >> name >> width >> height >> startX >> startY >> goalX >> goalY >> optimalLength))
+			continue;
+		if (mapName.empty()) {
+			mapName = name;
+			map = GridMap::loadMovingAI((path.parent_path() / name).string());
+		}
+		if (name != mapName || width != map.getWidth() || height != map.getHeight())
+			throw std::runtime_error(path.string() + " refers to more than one map");
+		if (std::max(startX, goalX) >= width || std::max(startY, goalY) >= height)
+			throw std::runtime_error(path.string() + " has a scenario outside of the map: " + line);
+		scenarios.push_back({ map.getCell(startX, startY), map.getCell(goalX, goalY), optimalLength });
+	}
+	return scenarios;
+}
+
+double getPercentile(std::vector<double> sorted, double percentile) {
+	if (sorted.empty())
+		return 0;
+	size_t index = static_cast<size_t>(percentile / 100 * (sorted.size() - 1) + 0.5);
+	return sorted[index];
+}
+
+int main(int argc, char* argv[]) {
+	std::filesystem::path directory = "Benchmarks/maps";
+	size_t repeat = 1;
+	std::string outputName;
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+			repeat = std::max<size_t>(1, std::stoul(argv[++i]));
+		else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			outputName = argv[++i];
+		else
+			directory = argv[i];
+	}
+	std::vector<std::filesystem::path> scenarioFiles;
+	if (std::filesystem::is_directory(directory)) {
+		for (auto& entry : std::filesystem::directory_iterator(directory)) {
+			if (entry.path().extension() == ".scen")
+				scenarioFiles.push_back(entry.path());
+		}
+	}
+	std::sort(scenarioFiles.begin(), scenarioFiles.end());
+	if (scenarioFiles.empty()) {
+		std::cerr << "No .scen files in " << directory.string() << "\n";
+		return 1;
+	}
+
+	std::ostringstream json;
+	json << "{\"benchmark\":\"PathfindingBenchmark\",\"version\":2,\"repeat\":" << repeat << ",\"runs\":[";
+	bool firstRun = true;
+	size_t totalMismatches = 0;
+	for (auto& scenarioFile : scenarioFiles) {
+		GridMap map;
+		std::string mapName;
+		std::vector<Scenario> scenarios;
+		try {
+			scenarios = loadScenarios(scenarioFile, map, mapName);
+		}
+		catch (const std::exception& e) {
+			std::cerr << e.what() << "\n";
+			return 1;
+		}
+		auto graph = map.buildGraph<Vertex>(true);
+		size_t searchKB = getSearchBytes(graph) / 1024;
+		for (auto& mode : modes) {
+			std::vector<double> latencies;
+			latencies.reserve(scenarios.size() * repeat);
+			size_t expansions = 0, pushes = 0, decreaseKeys = 0, peakOpenSize = 0, mismatches = 0;
+			double maxSuboptimality = 0, totalSeconds = 0;
+			for (size_t r = 0; r < repeat; ++r) {
+				for (auto& scenario : scenarios) {
+					AStarStats stats;
+					auto start = std::chrono::steady_clock::now();
+					auto path = mode.run(graph, scenario.from, scenario.to, stats);
+					auto latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+					totalSeconds += latency;
+					latencies.push_back(latency * 1e6);
+					expansions += stats.expansions;
+					pushes += stats.pushes;
+					decreaseKeys += stats.decreaseKeys;
+					peakOpenSize = std::max(peakOpenSize, stats.peakOpenSize);
+					// The costs are summed in float, allow for its rounding
+					double cost = path.empty() ? std::numeric_limits<double>::infinity() : path.back().second;
+					double tolerance = 1e-4 * scenario.optimalLength + 1e-3;
+					if (cost < scenario.optimalLength - tolerance || (mode.exact && cost > scenario.optimalLength + tolerance))
+						++mismatches;
+					if (scenario.optimalLength > 0)
+						maxSuboptimality = std::max(maxSuboptimality, cost / scenario.optimalLength - 1);
+				}
+			}
+			totalMismatches += mismatches;
+			std::sort(latencies.begin(), latencies.end());
+			double queries = static_cast<double>(latencies.size());
+			char run[1024];
+			std::snprintf(run, sizeof(run),
+				"%s{\"scenario\":\"%s\",\"map\":\"%s\",\"mode\":\"%s\",\"width\":%zu,\"height\":%zu,\"queries\":%zu,\"mismatches\":%zu,"
+				"\"max_suboptimality\":%.6f,\"queries_per_second\":%.1f,"
+				"\"latency_us\":{\"mean\":%.2f,\"p50\":%.2f,\"p95\":%.2f,\"p99\":%.2f,\"max\":%.2f},"
+				"\"expansions_per_query\":%.1f,\"pushes_per_query\":%.1f,\"decrease_keys_per_query\":%.1f,"
+				"\"peak_open_size\":%zu,\"search_memory_kb\":%zu,\"peak_open_list_kb\":%zu}",
+				firstRun ? "" : ",", scenarioFile.filename().string().c_str(), mapName.c_str(), mode.name, map.getWidth(), map.getHeight(),
+				latencies.size(), mismatches, maxSuboptimality, queries / totalSeconds,
+				totalSeconds * 1e6 / queries, getPercentile(latencies, 50), getPercentile(latencies, 95),
+				getPercentile(latencies, 99), latencies.back(),
+				expansions / queries, pushes / queries, decreaseKeys / queries, peakOpenSize,
+				searchKB, peakOpenSize * FibonacciHeap<size_t>::NodeSize / 1024);
+			json << run;
+			firstRun = false;
+			std::cerr << scenarioFile.filename().string() << " " << mode.name << ": " << mismatches << " mismatches, "
+				<< queries / totalSeconds << " queries/s\n";
+		}
+	}
+	json << "],\"peak_memory_kb\":" << getPeakMemoryKB() << "}\n";
+	if (outputName.empty())
+		std::cout << json.str();
+	else
+		std::ofstream(outputName) << json.str();
+	// A mismatch is a regression
+	return totalMismatches == 0 ? 0 : 2;
+}
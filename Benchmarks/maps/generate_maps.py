@@ -0,0 +1,104 @@
+# Generates the bundled MovingAI maps and scenarios used by PathfindingBenchmark
+# The optimal lengths are computed with an independent Dijkstra over octile moves without corner cutting,
+# the rules MovingAI uses for its scenarios.
+# Usage: python3 generate_maps.py (writes next to this script)
+import heapq
+import math
+import os
+import random
+
+DIRECTORY = os.path.dirname(os.path.abspath(__file__))
+SCENARIOS_PER_MAP = 100
+
+
+def random_map(width, height, density, rng):
+    return [['@' if rng.random() < density else '.' for _ in range(width)] for _ in range(height)]
+
+
+def rooms_map(width, height, room, rng):
+    grid = [['.'] * width for _ in range(height)]
+    for y in range(height):
+        for x in range(width):
+            if x % room == 0 or y % room == 0:
+                grid[y][x] = '@'
+    # Open doors in the walls between neighbouring rooms
+    for top in range(0, height - 1, room):
+        for left in range(0, width - 1, room):
+            if left + room < width:
+                grid[top + rng.randrange(1, room)][left + room] = '.'
+            if top + room < height:
+                grid[top + room][left + rng.randrange(1, room)] = '.'
+    return grid
+
+
+def maze_map(width, height, rng):
+    grid = [['@'] * width for _ in range(height)]
+    stack = [(1, 1)]
+    grid[1][1] = '.'
+    while stack:
+        x, y = stack[-1]
+        neighbours = [(x + dx, y + dy, dx, dy) for dx, dy in ((2, 0), (-2, 0), (0, 2), (0, -2))
+                      if 0 < x + dx < width - 1 and 0 < y + dy < height - 1 and grid[y + dy][x + dx] == '@']
+        if not neighbours:
+            stack.pop()
+            continue
+        nx, ny, dx, dy = rng.choice(neighbours)
+        grid[y + dy // 2][x + dx // 2] = '.'
+        grid[ny][nx] = '.'
+        stack.append((nx, ny))
+    return grid
+
+
+def distances(grid, start):
+    height, width = len(grid), len(grid[0])
+
+    def free(x, y):
+        return 0 <= x < width and 0 <= y < height and grid[y][x] == '.'
+    best = {start: 0.0}
+    queue = [(0.0, start)]
+    while queue:
+        cost, (x, y) = heapq.heappop(queue)
+        if cost > best[(x, y)]:
+            continue
+        for dx in (-1, 0, 1):
+            for dy in (-1, 0, 1):
+                if (dx == 0 and dy == 0) or not free(x + dx, y + dy):
+                    continue
+                if dx != 0 and dy != 0 and not (free(x + dx, y) and free(x, y + dy)):
+                    continue
+                next_cost = cost + (math.sqrt(2) if dx != 0 and dy != 0 else 1.0)
+                if next_cost < best.get((x + dx, y + dy), math.inf):
+                    best[(x + dx, y + dy)] = next_cost
+                    heapq.heappush(queue, (next_cost, (x + dx, y + dy)))
+    return best
+
+
+def write(name, grid, rng):
+    height, width = len(grid), len(grid[0])
+    with open(os.path.join(DIRECTORY, name + '.map'), 'w', newline='\n') as out:
+        out.write('type octile\nheight %d\nwidth %d\nmap\n' % (height, width))
+        for row in grid:
+            out.write(''.join(row) + '\n')
+    free = [(x, y) for y in range(height) for x in range(width) if grid[y][x] == '.']
+    lines = []
+    while len(lines) < SCENARIOS_PER_MAP:
+        start = rng.choice(free)
+        reachable = distances(grid, start)
+        if len(reachable) < 2:
+            continue
+        goal = rng.choice(sorted(reachable))
+        if goal == start:
+            continue
+        length = reachable[goal]
+        lines.append('%d\t%s.map\t%d\t%d\t%d\t%d\t%d\t%d\t%.8f' %
+                     (int(length // 4), name, width, height, start[0], start[1], goal[0], goal[1], length))
+    with open(os.path.join(DIRECTORY, name + '.map.scen'), 'w', newline='\n') as out:
+        out.write('version 1\n')
+        out.write('\n'.join(lines) + '\n')
+
+
+if __name__ == '__main__':
+    rng = random.Random(20240601)
+    write('random20_256', random_map(256, 256, 0.2, rng), rng)
+    write('rooms_256', rooms_map(256, 256, 16, rng), rng)
+    write('maze_129', maze_map(129, 129, rng), rng)
@@ -0,0 +1,141 @@
+// Answers path queries on a map with the A* core, without the visualization
+// Usage: PathQuery <map> <queries> [--diagonal] [--threads N]
+// The map is in the MovingAI format. Each query line is either a MovingAI scenario line
+// "bucket map width height startX startY goalX goalY optimalLength" or "startX startY goalX goalY",
+// lines that are neither, such as the "version" line of a scenario file, are skipped.
+// Writes one tab separated line per query to stdout as soon as it is answered:
+// id, found, path length in cells, cost, expansions and latency in microseconds.
+#include "../AStarVisualization/AStarSearch.hpp"
+#include "../AStarVisualization/GridMap.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+struct Vertex {
+	std::pair<float, float> pos;
+	float gScore, fScore;
+	size_t parent;
+};
+
+struct Query {
+	size_t from, to;
+};
+
+// Read the queries, the coordinates must be inside the map
+std::vector<Query> loadQueries(const std::string& fileName, const GridMap& map) {
+	std::ifstream in(fileName);
+	if (!in)
+		throw std::runtime_error("Can not open " + fileName);
+	std::vector<Query> queries;
+	std::string line;
+	while (std::getline(in, line)) {
+		std::istringstream fields(line);
+		std::vector<std::string> tokens;
+		for (std::string token; fields >> token;)
+			tokens.push_back(token);
+		size_t first;
+		if (tokens.size() == 9)
+			first = 4;
+		else if (tokens.size() == 4)
+			first = 0;
+		else
+			continue;
+		size_t startX = std::stoul(tokens[first]), startY = std::stoul(tokens[first + 1]);
+		size_t goalX = std::stoul(tokens[first + 2]), goalY = std::stoul(tokens[first + 3]);
+		if (std::max(startX, goalX) >= map.getWidth() || std::max(startY, goalY) >= map.getHeight())
+			throw std::runtime_error("Query outside of the map: " + line);
+		queries.push_back({ map.getCell(startX, startY), map.getCell(goalX, goalY) });
+	}
+	return queries;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		std::fprintf(stderr, "Usage: %s <map> <queries> [--diagonal] [--threads N]\n", argv[0]);
+		return 1;
+	}
+	bool diagonal = false;
+	size_t threads = 1;
+	for (int i = 3; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--diagonal") == 0)
+			diagonal = true;
+		else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			threads = std::max<size_t>(1, std::stoul(argv[++i]));
+		else {
+			std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	GridMap map;
+	std::vector<Query> queries;
+	try {
+		map = GridMap::loadMovingAI(argv[1]);
+		queries = loadQueries(argv[2], map);
+	}
+	catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+	const auto graph = map.buildGraph<Vertex>(diagonal);
+	// Manhattan distance on 4 connected grids, octile distance with diagonal moves
+	AStarSearch<Vertex>::Heuristic heuristic;
+	if (diagonal) {
+		heuristic = [](const std::pair<float, float>& posA, const std::pair<float, float>& posB) {
+			float dy = std::abs(posA.first - posB.first), dx = std::abs(posA.second - posB.second);
+			return std::max(dx, dy) + (std::sqrt(2.f) - 1) * std::min(dx, dy);
+		};
+	}
+	else {
+		heuristic = [](const std::pair<float, float>& posA, const std::pair<float, float>& posB) {
+			return std::abs(posA.first - posB.first) + std::abs(posA.second - posB.second);
+		};
+	}
+
+	std::printf("id\tfound\tlength\tcost\texpansions\tlatency_us\n");
+	std::mutex outputMutex;
+	std::atomic<size_t> next{ 0 };
+	// The search keeps its state in the vertex attributes, so every thread works on its own copy of the graph
+	auto answer = [&]() {
+		auto localGraph = graph;
+		auto isBlocked = [](size_t) { return false; };
+		auto onVisit = [](size_t, VisitState) {};
+		for (size_t id = next++; id < queries.size(); id = next++) {
+			auto& query = queries[id];
+			auto start = std::chrono::steady_clock::now();
+			bool found = false;
+			size_t length = 0, expansions = 0;
+			float cost = 0;
+			if (!map.isBlocked(query.from) && !map.isBlocked(query.to)) {
+				AStarSearch<Vertex, decltype(isBlocked), decltype(onVisit)> search(localGraph, query.from, query.to,
+					heuristic, isBlocked, onVisit);
+				search.step();
+				auto& path = search.getPath();
+				expansions = search.getExpansions();
+				// An unreachable target keeps an infinite gScore
+				found = !path.empty() && std::isfinite(path.back().second);
+				if (found) {
+					length = path.size();
+					cost = path.back().second;
+				}
+			}
+			double latency = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+			char line[128];
+			int size = std::snprintf(line, sizeof(line), "%zu\t%d\t%zu\t%.4f\t%zu\t%.1f\n", id, found ? 1 : 0, length, cost, expansions, latency);
+			std::lock_guard<std::mutex> lock(outputMutex);
+			std::fwrite(line, 1, size, stdout);
+		}
+	};
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < threads; ++i)
+		workers.emplace_back(answer);
+	answer();
+	for (auto& worker : workers)
+		worker.join();
+	return 0;
+}
@@ -0,0 +1,93 @@
+// Converts the binary trace written by prof::Profiler to Chrome trace JSON (chrome://tracing, Perfetto)
+// Usage: ProfileConverter [input=profile_result.bin] [output=profile_result.json]
+#include "../AStarVisualization/Profiler.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <unordered_map>
+
+template <class T>
+bool read(std::ifstream& in, T& value) {
+	return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+// Escape a name for a JSON string, control characters are written as \u00XX
+std::string escape(const std::string& name) {
+	std::string escaped;
+	for (char c : name) {
+		if (static_cast<unsigned char>(c) < 0x20) {
+			char code[7];
+			std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned>(c));
+			escaped += code;
+			continue;
+		}
+		if (c == '"' || c == '\\')
+			escaped += '\\';
+		escaped += c;
+	}
+	return escaped;
+}
+
+int main(int argc, char** argv) {
+	const char* inputName = argc > 1 ? argv[1] : "profile_result.bin";
+	const char* outputName = argc > 2 ? argv[2] : "profile_result.json";
+	std::ifstream in(inputName, std::ios::binary);
+	if (!in) {
+		std::fprintf(stderr, "Can not open %s\n", inputName);
+		return 1;
+	}
+	char magic[4];
+	uint32_t version;
+	if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, prof::format::Magic, sizeof(magic)) != 0
+		|| !read(in, version) || version != prof::format::Version) {
+		std::fprintf(stderr, "%s is not a profiler trace of version %u\n", inputName, prof::format::Version);
+		return 1;
+	}
+	std::ofstream out(outputName);
+	// Chrome traces are in microseconds, printed with nanosecond digits
+	out << std::fixed << std::setprecision(3);
+	out << "{\"traceEvents\":[";
+	std::unordered_map<uint32_t, std::string> names;
+	size_t events = 0;
+	prof::format::RecordType type;
+	while (read(in, type)) {
+		if (type == prof::format::RecordType::NAME) {
+			uint32_t id, length;
+			if (!read(in, id) || !read(in, length))
+				break;
+			std::string name(length, '\0');
+			if (!in.read(name.data(), length))
+				break;
+			names[id] = escape(name);
+		}
+		else if (type == prof::format::RecordType::SCOPE || type == prof::format::RecordType::COUNTER) {
+			uint32_t nameId, threadIndex;
+			int64_t time, value;
+			uint64_t allocations = 0, allocatedBytes = 0;
+			if (!read(in, nameId) || !read(in, threadIndex) || !read(in, time) || !read(in, value))
+				break;
+			if (type == prof::format::RecordType::SCOPE && (!read(in, allocations) || !read(in, allocatedBytes)))
+				break;
+			if (events != 0)
+				out << ",";
+			out << "{\"name\":\"" << names[nameId] << "\",";
+			if (type == prof::format::RecordType::COUNTER)
+				out << "\"ph\":\"C\",\"pid\":0,\"tid\":" << threadIndex << ",\"ts\":" << time / 1000.0
+					<< ",\"args\":{\"value\":" << value << "}}";
+			else {
+				out << "\"dur\":" << value / 1000.0 << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << threadIndex << ",\"ts\":" << time / 1000.0;
+				if (allocations != 0)
+					out << ",\"args\":{\"allocations\":" << allocations << ",\"bytes\":" << allocatedBytes << "}";
+				out << "}";
+			}
+			++events;
+		}
+		else {
+			std::fprintf(stderr, "Unknown record type %u, the rest of the trace is skipped\n", static_cast<unsigned>(type));
+			break;
+		}
+	}
+	out << "]}";
+	std::printf("%zu events written to %s\n", events, outputName);
+	return 0;
+}